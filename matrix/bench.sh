@@ -0,0 +1,11 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -O2 -pthread -I./ bench/bench.cpp src/matrix.cpp src/gemm.cpp src/kernels.cpp src/lu.cpp \
+    src/thread_pool.cpp src/matrix_io.cpp src/strassen.cpp \
+    src/sparse_matrix.cpp src/triangular.cpp src/cholesky.cpp src/qr.cpp \
+    src/matrix_batch.cpp src/aligned_memory.cpp src/factorized_matrix.cpp -o matrix_bench
+./matrix_bench "$@"
+
+rm matrix_bench
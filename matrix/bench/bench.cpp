@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "src/kernels.h"
+#include "src/matrix.h"
+#include "src/matrix_batch.h"
+
+// Every global allocation is counted so benchmarks can report allocations per operation.
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+
+void *counted_alloc(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void *counted_aligned_alloc(size_t size, std::align_val_t alignment) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  size_t align = static_cast<size_t>(alignment);
+  if (void *pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  return counted_alloc(size);
+}
+
+void *operator new[](size_t size) {
+  return counted_alloc(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  return counted_aligned_alloc(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return counted_aligned_alloc(size, alignment);
+}
+
+void operator delete(void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+using task::Matrix;
+using task::MatrixBatch;
+using Clock = std::chrono::steady_clock;
+
+template <class T>
+void do_not_optimize(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Timing state of one run; only the iterations of the keep_running() loop are measured,
+// so setup done before the loop is free.
+class State {
+
+ public:
+
+  State(size_t size, size_t iterations) : size(size), iterations(iterations) {}
+
+  bool keep_running() {
+    if (this->done == 0) {
+      this->allocations = allocation_count.load();
+      this->start = Clock::now();
+    }
+    if (this->done == this->iterations) {
+      this->elapsed = std::chrono::duration<double>(Clock::now() - this->start).count();
+      this->allocations = allocation_count.load() - this->allocations;
+      return false;
+    }
+    ++this->done;
+    return true;
+  }
+
+  // Work done by one operation, used for the GFLOP/s and bytes/s columns.
+  void set_flops(double flops) {
+    this->flops = flops;
+  }
+
+  void set_bytes(double bytes) {
+    this->bytes = bytes;
+  }
+
+  size_t size;
+  size_t iterations;
+  size_t done = 0;
+  size_t allocations = 0;
+  double elapsed = 0;
+  double flops = 0;
+  double bytes = 0;
+
+ private:
+
+  Clock::time_point start;
+
+};
+
+struct Benchmark {
+  std::string name;
+  // Largest size the benchmark runs at; text I/O and cubic operations stop earlier.
+  size_t max_size;
+  std::function<void(State &)> body;
+};
+
+struct Options {
+  double min_time = 0.2;
+  size_t max_size = 4096;
+  std::string filter;
+  std::string output;
+};
+
+Matrix random_matrix(size_t rows, size_t cols, unsigned seed) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> distribution(-10., 10.);
+  Matrix result(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      result[i][j] = distribution(generator);
+    }
+  }
+  return result;
+}
+
+double square_bytes(size_t n, double count) {
+  return count * n * n * sizeof(double);
+}
+
+const size_t BATCH_COUNT = 10000;
+
+MatrixBatch random_batch(size_t n, unsigned seed) {
+  MatrixBatch result(BATCH_COUNT, n, n);
+  for (size_t index = 0; index < BATCH_COUNT; ++index) {
+    result.set_matrix(index, random_matrix(n, n, seed + index));
+  }
+  return result;
+}
+
+std::vector<Benchmark> benchmarks() {
+  return {
+      {"construct", 4096, [](State &state) {
+        while (state.keep_running()) {
+          Matrix m(state.size, state.size);
+          do_not_optimize(m);
+        }
+        state.set_bytes(square_bytes(state.size, 1));
+      }},
+      {"copy", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        while (state.keep_running()) {
+          Matrix m(a);
+          do_not_optimize(m);
+        }
+        state.set_bytes(square_bytes(state.size, 2));
+      }},
+      {"resize", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        bool grow = true;
+        while (state.keep_running()) {
+          a.resize(state.size, grow ? state.size + 1 : state.size);
+          grow = !grow;
+          do_not_optimize(a);
+        }
+        state.set_bytes(square_bytes(state.size, 2));
+      }},
+      {"add", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        Matrix b = random_matrix(state.size, state.size, 2);
+        Matrix c;
+        while (state.keep_running()) {
+          c = a + b;
+          do_not_optimize(c);
+        }
+        state.set_flops(static_cast<double>(state.size) * state.size);
+        state.set_bytes(square_bytes(state.size, 3));
+      }},
+      {"multiply", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        Matrix b = random_matrix(state.size, state.size, 2);
+        while (state.keep_running()) {
+          Matrix c = a * b;
+          do_not_optimize(c);
+        }
+        state.set_flops(2.0 * state.size * state.size * state.size);
+        state.set_bytes(square_bytes(state.size, 3));
+      }},
+      {"det", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        while (state.keep_running()) {
+          double d = a.det();
+          do_not_optimize(d);
+        }
+        state.set_flops(2.0 / 3 * state.size * state.size * state.size);
+        state.set_bytes(square_bytes(state.size, 2));
+      }},
+      {"transpose", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        while (state.keep_running()) {
+          a.transpose();
+          do_not_optimize(a);
+        }
+        state.set_bytes(square_bytes(state.size, 2));
+      }},
+      {"transposed", 4096, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        while (state.keep_running()) {
+          Matrix t = a.transposed();
+          do_not_optimize(t);
+        }
+        state.set_bytes(square_bytes(state.size, 2));
+      }},
+      {"batch_multiply", 16, [](State &state) {
+        MatrixBatch a = random_batch(state.size, 1);
+        MatrixBatch b = random_batch(state.size, 2);
+        MatrixBatch c(0, 0, 0);
+        while (state.keep_running()) {
+          c.multiply(a, b);
+          do_not_optimize(c);
+        }
+        state.set_flops(2.0 * BATCH_COUNT * state.size * state.size * state.size);
+        state.set_bytes(square_bytes(state.size, 3.0 * BATCH_COUNT));
+      }},
+      {"batch_det", 16, [](State &state) {
+        MatrixBatch a = random_batch(state.size, 1);
+        while (state.keep_running()) {
+          std::vector<double> d = a.det();
+          do_not_optimize(d);
+        }
+        state.set_flops(2.0 / 3 * BATCH_COUNT * state.size * state.size * state.size);
+        state.set_bytes(square_bytes(state.size, BATCH_COUNT));
+      }},
+      {"stream_write", 1024, [](State &state) {
+        Matrix a = random_matrix(state.size, state.size, 1);
+        size_t length = 0;
+        while (state.keep_running()) {
+          std::ostringstream output;
+          output << a;
+          length = output.tellp();
+        }
+        state.set_bytes(static_cast<double>(length));
+      }},
+      {"stream_read", 1024, [](State &state) {
+        std::ostringstream output;
+        output << state.size << " " << state.size << "\n" << random_matrix(state.size, state.size, 1);
+        std::string text = output.str();
+        Matrix m;
+        while (state.keep_running()) {
+          std::istringstream input(text);
+          input >> m;
+          do_not_optimize(m);
+        }
+        state.set_bytes(static_cast<double>(text.size()));
+      }},
+  };
+}
+
+// Runs once to estimate the cost, then repeats until the measured loop lasts min_time.
+State measure(const Benchmark &benchmark, size_t size, double min_time) {
+  State probe(size, 1);
+  benchmark.body(probe);
+  if (probe.elapsed >= min_time) {
+    return probe;
+  }
+  double estimate = min_time / std::max(probe.elapsed, 1e-9);
+  State state(size, static_cast<size_t>(std::min(estimate, 1e9)) + 1);
+  benchmark.body(state);
+  return state;
+}
+
+const char *simd_name() {
+  switch (task::simd_level()) {
+    case task::SimdLevel::AVX512:
+      return "avx512";
+    case task::SimdLevel::AVX2:
+      return "avx2";
+    default:
+      return "sse2";
+  }
+}
+
+void write_result(std::ostream &output, const std::string &name, const State &state, bool last) {
+  double seconds = state.elapsed / state.iterations;
+  output << "    {\"name\": \"" << name << "/" << state.size << "\", "
+         << "\"size\": " << state.size << ", "
+         << "\"iterations\": " << state.iterations << ", "
+         << "\"real_time_ns\": " << seconds * 1e9 << ", "
+         << "\"gflops\": " << state.flops / seconds / 1e9 << ", "
+         << "\"bytes_per_second\": " << state.bytes / seconds << ", "
+         << "\"allocs_per_op\": " << static_cast<double>(state.allocations) / state.iterations
+         << "}" << (last ? "\n" : ",\n");
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    auto value = [&argument](const std::string &flag) {
+      return argument.substr(flag.size());
+    };
+    if (argument.rfind("--min-time=", 0) == 0) {
+      options.min_time = std::stod(value("--min-time="));
+    } else if (argument.rfind("--max-size=", 0) == 0) {
+      options.max_size = std::stoul(value("--max-size="));
+    } else if (argument.rfind("--filter=", 0) == 0) {
+      options.filter = value("--filter=");
+    } else if (argument.rfind("--out=", 0) == 0) {
+      options.output = value("--out=");
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--min-time=SECONDS] [--max-size=N] [--filter=SUBSTRING] [--out=FILE]\n";
+      std::exit(2);
+    }
+  }
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options = parse_options(argc, argv);
+  std::ostringstream results;
+  std::vector<std::pair<std::string, State>> rows;
+  for (const Benchmark &benchmark : benchmarks()) {
+    if (benchmark.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    for (size_t size = 4; size <= std::min(options.max_size, benchmark.max_size); size *= 4) {
+      State state = measure(benchmark, size, options.min_time);
+      std::cerr << benchmark.name << "/" << size << ": " << state.elapsed / state.iterations * 1e9
+                << " ns\n";
+      rows.emplace_back(benchmark.name, state);
+    }
+  }
+  std::time_t now = std::time(nullptr);
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  results << "{\n  \"context\": {\"date\": \"" << date << "\", "
+          << "\"num_threads\": " << task::num_threads() << ", "
+          << "\"simd\": \"" << simd_name() << "\", "
+          << "\"min_time\": " << options.min_time << "},\n"
+          << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    write_result(results, rows[i].first, rows[i].second, i + 1 == rows.size());
+  }
+  results << "  ]\n}\n";
+  if (options.output.empty()) {
+    std::cout << results.str();
+  } else {
+    std::ofstream(options.output) << results.str();
+  }
+  return 0;
+}
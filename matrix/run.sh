@@ -4,7 +4,10 @@ set -e
 
 STRESS_TEST_COUNT=500
 
-g++ -std=c++17 -I./ test/test.cpp src/matrix.cpp -o matrix_test
+g++ -std=c++17 -O2 -pthread -I./ test/test.cpp src/matrix.cpp src/gemm.cpp src/kernels.cpp src/lu.cpp \
+    src/thread_pool.cpp src/matrix_io.cpp src/strassen.cpp \
+    src/sparse_matrix.cpp src/triangular.cpp src/cholesky.cpp src/qr.cpp \
+    src/matrix_batch.cpp src/aligned_memory.cpp src/factorized_matrix.cpp -o matrix_test
 python3 test/generate.py $STRESS_TEST_COUNT > test_data
 ./matrix_test $STRESS_TEST_COUNT < test_data
 
@@ -0,0 +1,117 @@
+#include "aligned_memory.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+using namespace task;
+
+namespace {
+
+class AlignedResource : public std::pmr::memory_resource {
+
+ private:
+
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    return ::operator new(bytes, std::align_val_t(std::max(alignment, MATRIX_ALIGNMENT)));
+  }
+
+  void do_deallocate(void *pointer, size_t, size_t alignment) override {
+    ::operator delete(pointer, std::align_val_t(std::max(alignment, MATRIX_ALIGNMENT)));
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+};
+
+// Blocks up to SCRATCH_BLOCK_BYTES are cached, at most SCRATCH_BLOCKS of them per thread.
+const size_t SCRATCH_BLOCK_BYTES = 1 << 20;
+const size_t SCRATCH_BLOCKS = 8;
+
+// Keeps recently freed blocks and hands them back out for requests of the same size and
+// alignment. Blocks are reused where aligned_resource() placed them: size-class pools such as
+// std::pmr::unsynchronized_pool_resource put equal blocks on page boundaries, which makes
+// row-strided kernels on them suffer from 4K aliasing.
+class ScratchResource : public std::pmr::memory_resource {
+
+ public:
+
+  ScratchResource() {
+    this->blocks.reserve(SCRATCH_BLOCKS);
+  }
+
+  ~ScratchResource() override {
+    for (const Block &block : this->blocks) {
+      aligned_resource()->deallocate(block.pointer, block.bytes, block.alignment);
+    }
+  }
+
+ private:
+
+  struct Block {
+    void *pointer;
+    size_t bytes;
+    size_t alignment;
+  };
+
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    for (size_t i = this->blocks.size(); i > 0; --i) {
+      Block &block = this->blocks[i - 1];
+      if (block.bytes == bytes && block.alignment == alignment) {
+        void *pointer = block.pointer;
+        this->blocks.erase(this->blocks.begin() + (i - 1));
+        return pointer;
+      }
+    }
+    return aligned_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *pointer, size_t bytes, size_t alignment) override {
+    if (bytes > SCRATCH_BLOCK_BYTES) {
+      aligned_resource()->deallocate(pointer, bytes, alignment);
+      return;
+    }
+    if (this->blocks.size() == SCRATCH_BLOCKS) {
+      const Block &oldest = this->blocks.front();
+      aligned_resource()->deallocate(oldest.pointer, oldest.bytes, oldest.alignment);
+      this->blocks.erase(this->blocks.begin());
+    }
+    this->blocks.push_back({pointer, bytes, alignment});
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  std::vector<Block> blocks;
+
+};
+
+// nullptr stands for aligned_resource(), so the default is usable during static initialization.
+std::atomic<std::pmr::memory_resource *> default_resource(nullptr);
+
+}  // namespace
+
+std::pmr::memory_resource *task::aligned_resource() {
+  static AlignedResource resource;
+  return &resource;
+}
+
+std::pmr::memory_resource *task::default_matrix_resource() {
+  std::pmr::memory_resource *resource = default_resource.load(std::memory_order_acquire);
+  return resource != nullptr ? resource : aligned_resource();
+}
+
+std::pmr::memory_resource *task::set_default_matrix_resource(
+    std::pmr::memory_resource *resource) {
+  std::pmr::memory_resource *previous = default_resource.exchange(resource,
+                                                                  std::memory_order_acq_rel);
+  return previous != nullptr ? previous : aligned_resource();
+}
+
+std::pmr::memory_resource *task::scratch_resource() {
+  thread_local ScratchResource resource;
+  return &resource;
+}
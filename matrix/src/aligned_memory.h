@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace task {
+
+const size_t MATRIX_ALIGNMENT = 64;
+
+// aligned operator new/delete; requests for a smaller alignment get MATRIX_ALIGNMENT.
+std::pmr::memory_resource *aligned_resource();
+
+// Used by matrices constructed without a resource; aligned_resource() until replaced.
+std::pmr::memory_resource *default_matrix_resource();
+// Returns the previous default; nullptr restores aligned_resource(). Matrices keep the
+// resource they were constructed with.
+std::pmr::memory_resource *set_default_matrix_resource(std::pmr::memory_resource *resource);
+
+// Per-thread cache over aligned_resource() for temporaries that live within one operation,
+// such as the factors behind det(); freed blocks are reused by the next operation of the
+// same size. Memory from it must be freed on the thread that allocated it.
+std::pmr::memory_resource *scratch_resource();
+
+}  // namespace task
@@ -0,0 +1,743 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include "gemm.h"
+#include "matrix.h"
+
+namespace task {
+
+// Marks a dimension that is only known at run time.
+const size_t Dynamic = static_cast<size_t>(-1);
+
+namespace detail {
+
+template <class T>
+constexpr bool nearly_equal(T left, T right) {
+  if constexpr (std::is_floating_point<T>::value) {
+    T diff = left - right;
+    return !(diff > EPS || -diff > EPS);
+  } else {
+    return left == right;
+  }
+}
+
+// Determinant of the n x n row-major array a, destroying a. Floating types use partial
+// pivoting; integral types use fraction-free Bareiss elimination, so the result is exact.
+template <class T>
+constexpr T determinant(T *a, size_t n) {
+  if (n == 0) {
+    return T(1);
+  }
+  T sign = T(1);
+  T previous = T(1);
+  for (size_t k = 0; k + 1 < n; ++k) {
+    size_t p = k;
+    for (size_t i = k + 1; i < n; ++i) {
+      T candidate = a[i * n + k] < T(0) ? -a[i * n + k] : a[i * n + k];
+      T best = a[p * n + k] < T(0) ? -a[p * n + k] : a[p * n + k];
+      if (std::is_floating_point<T>::value ? candidate > best : best == T(0) && candidate != T(0)) {
+        p = i;
+      }
+    }
+    if (a[p * n + k] == T(0)) {
+      return T(0);
+    }
+    if (p != k) {
+      for (size_t j = 0; j < n; ++j) {
+        T tmp = a[k * n + j];
+        a[k * n + j] = a[p * n + j];
+        a[p * n + j] = tmp;
+      }
+      sign = -sign;
+    }
+    for (size_t i = k + 1; i < n; ++i) {
+      if constexpr (std::is_floating_point<T>::value) {
+        T factor = a[i * n + k] / a[k * n + k];
+        for (size_t j = k + 1; j < n; ++j) {
+          a[i * n + j] -= factor * a[k * n + j];
+        }
+      } else {
+        for (size_t j = k + 1; j < n; ++j) {
+          a[i * n + j] = (a[i * n + j] * a[k * n + k] - a[i * n + k] * a[k * n + j]) / previous;
+        }
+      }
+    }
+    if constexpr (!std::is_floating_point<T>::value) {
+      previous = a[k * n + k];
+    }
+  }
+  if constexpr (std::is_floating_point<T>::value) {
+    T d = sign;
+    for (size_t i = 0; i < n; ++i) {
+      d *= a[i * n + i];
+    }
+    return d;
+  } else {
+    return sign * a[(n - 1) * n + (n - 1)];
+  }
+}
+
+}  // namespace detail
+
+// Matrix over T with compile-time dimensions: storage lives inside the object, every loop has
+// constant bounds and all operations are constexpr. Use Dynamic for both dimensions to get a
+// heap-backed matrix instead. Like task::Matrix, constructors build an identity matrix.
+template <class T, size_t Rows, size_t Cols>
+class BasicMatrix {
+
+  static_assert(Rows != Dynamic && Cols != Dynamic,
+                "dimensions must be both fixed or both Dynamic");
+  static_assert(std::is_arithmetic<T>::value, "element type must be arithmetic");
+
+ public:
+
+  using value_type = T;
+
+  constexpr BasicMatrix();
+  constexpr BasicMatrix(std::initializer_list<T> values);
+  explicit BasicMatrix(const Matrix &matrix);
+
+  static constexpr BasicMatrix zero();
+
+  constexpr size_t n_rows() const {
+    return Rows;
+  }
+
+  constexpr size_t n_cols() const {
+    return Cols;
+  }
+
+  constexpr T &get(size_t row, size_t col);
+  constexpr const T &get(size_t row, size_t col) const;
+  constexpr void set(size_t row, size_t col, const T &value);
+
+  constexpr T *operator[](size_t row) {
+    return this->values + row * Cols;
+  }
+
+  constexpr const T *operator[](size_t row) const {
+    return this->values + row * Cols;
+  }
+
+  constexpr BasicMatrix &operator+=(const BasicMatrix &a);
+  constexpr BasicMatrix &operator-=(const BasicMatrix &a);
+  constexpr BasicMatrix &operator*=(const T &number);
+  template <size_t K, class = std::enable_if_t<K == Cols && K == Rows>>
+  constexpr BasicMatrix &operator*=(const BasicMatrix<T, K, K> &a);
+
+  constexpr BasicMatrix operator+(const BasicMatrix &a) const;
+  constexpr BasicMatrix operator-(const BasicMatrix &a) const;
+  constexpr BasicMatrix operator*(const T &number) const;
+  template <size_t K>
+  constexpr BasicMatrix<T, Rows, K> operator*(const BasicMatrix<T, Cols, K> &a) const;
+  constexpr BasicMatrix operator-() const;
+  constexpr BasicMatrix operator+() const;
+
+  constexpr T det() const;
+  constexpr BasicMatrix<T, Cols, Rows> transposed() const;
+  constexpr T trace() const;
+
+  constexpr bool operator==(const BasicMatrix &a) const;
+  constexpr bool operator!=(const BasicMatrix &a) const;
+
+  Matrix to_matrix() const;
+
+ private:
+
+  T values[Rows * Cols]{};
+
+};
+
+// Heap-backed matrix over T with run-time dimensions. Products of double matrices go through gemm.
+template <class T>
+class BasicMatrix<T, Dynamic, Dynamic> {
+
+  static_assert(std::is_arithmetic<T>::value, "element type must be arithmetic");
+
+ public:
+
+  using value_type = T;
+
+  BasicMatrix();
+  BasicMatrix(size_t rows, size_t cols);
+  explicit BasicMatrix(const Matrix &matrix);
+  BasicMatrix(const BasicMatrix &copy);
+  BasicMatrix(BasicMatrix &&other) noexcept;
+  BasicMatrix &operator=(const BasicMatrix &a);
+  BasicMatrix &operator=(BasicMatrix &&other) noexcept;
+  ~BasicMatrix();
+  void swap(BasicMatrix &other) noexcept;
+
+  size_t n_rows() const;
+  size_t n_cols() const;
+
+  T &get(size_t row, size_t col);
+  const T &get(size_t row, size_t col) const;
+  void set(size_t row, size_t col, const T &value);
+
+  T *operator[](size_t row);
+  const T *operator[](size_t row) const;
+
+  BasicMatrix &operator+=(const BasicMatrix &a);
+  BasicMatrix &operator-=(const BasicMatrix &a);
+  BasicMatrix &operator*=(const T &number);
+  BasicMatrix &operator*=(const BasicMatrix &a);
+
+  BasicMatrix operator+(const BasicMatrix &a) const;
+  BasicMatrix operator-(const BasicMatrix &a) const;
+  BasicMatrix operator*(const T &number) const;
+  BasicMatrix operator*(const BasicMatrix &a) const;
+  BasicMatrix operator-() const;
+  BasicMatrix operator+() const;
+
+  T det() const;
+  void transpose();
+  BasicMatrix transposed() const;
+  T trace() const;
+
+  bool operator==(const BasicMatrix &a) const;
+  bool operator!=(const BasicMatrix &a) const;
+
+  Matrix to_matrix() const;
+
+ private:
+
+  size_t rows;
+  size_t cols;
+  T *array;
+
+};
+
+template <class T>
+using MatrixX = BasicMatrix<T, Dynamic, Dynamic>;
+
+using Matrix2f = BasicMatrix<float, 2, 2>;
+using Matrix3f = BasicMatrix<float, 3, 3>;
+using Matrix4f = BasicMatrix<float, 4, 4>;
+using Matrix2d = BasicMatrix<double, 2, 2>;
+using Matrix3d = BasicMatrix<double, 3, 3>;
+using Matrix4d = BasicMatrix<double, 4, 4>;
+using Matrix2i = BasicMatrix<int32_t, 2, 2>;
+using Matrix3i = BasicMatrix<int32_t, 3, 3>;
+using Matrix4i = BasicMatrix<int32_t, 4, 4>;
+using Matrix2l = BasicMatrix<int64_t, 2, 2>;
+using Matrix3l = BasicMatrix<int64_t, 3, 3>;
+using Matrix4l = BasicMatrix<int64_t, 4, 4>;
+using MatrixXf = MatrixX<float>;
+using MatrixXd = MatrixX<double>;
+using MatrixXi = MatrixX<int32_t>;
+using MatrixXl = MatrixX<int64_t>;
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> operator*(const T &number, const BasicMatrix<T, Rows, Cols> &a) {
+  return a * number;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> operator*(const T &number, const BasicMatrix<T, Dynamic, Dynamic> &a) {
+  return a * number;
+}
+
+// ---- fixed size ----
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols>::BasicMatrix() {
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows && i < Cols; ++i) {
+    this->values[i * Cols + i] = T(1);
+  }
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols>::BasicMatrix(std::initializer_list<T> values) {
+  if (values.size() != Rows * Cols) {
+    throw SizeMismatchException();
+  }
+  size_t i = 0;
+  for (const T &value : values) {
+    this->values[i++] = value;
+  }
+}
+
+template <class T, size_t Rows, size_t Cols>
+BasicMatrix<T, Rows, Cols>::BasicMatrix(const Matrix &matrix) {
+  if (matrix.n_rows() != Rows || matrix.n_cols() != Cols) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < Rows; ++i) {
+    for (size_t j = 0; j < Cols; ++j) {
+      this->values[i * Cols + j] = static_cast<T>(matrix.at(i, j));
+    }
+  }
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> BasicMatrix<T, Rows, Cols>::zero() {
+  BasicMatrix result;
+  for (size_t i = 0; i < Rows && i < Cols; ++i) {
+    result.values[i * Cols + i] = T(0);
+  }
+  return result;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr T &BasicMatrix<T, Rows, Cols>::get(size_t row, size_t col) {
+  if (row >= Rows || col >= Cols) {
+    throw OutOfBoundsException();
+  }
+  return this->values[row * Cols + col];
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr const T &BasicMatrix<T, Rows, Cols>::get(size_t row, size_t col) const {
+  if (row >= Rows || col >= Cols) {
+    throw OutOfBoundsException();
+  }
+  return this->values[row * Cols + col];
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr void BasicMatrix<T, Rows, Cols>::set(size_t row, size_t col, const T &value) {
+  get(row, col) = value;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> &BasicMatrix<T, Rows, Cols>::operator+=(const BasicMatrix &a) {
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows * Cols; ++i) {
+    this->values[i] += a.values[i];
+  }
+  return *this;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> &BasicMatrix<T, Rows, Cols>::operator-=(const BasicMatrix &a) {
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows * Cols; ++i) {
+    this->values[i] -= a.values[i];
+  }
+  return *this;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> &BasicMatrix<T, Rows, Cols>::operator*=(const T &number) {
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows * Cols; ++i) {
+    this->values[i] *= number;
+  }
+  return *this;
+}
+
+template <class T, size_t Rows, size_t Cols>
+template <size_t K, class>
+constexpr BasicMatrix<T, Rows, Cols> &BasicMatrix<T, Rows, Cols>::operator*=(
+    const BasicMatrix<T, K, K> &a) {
+  *this = *this * a;
+  return *this;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> BasicMatrix<T, Rows, Cols>::operator+(const BasicMatrix &a) const {
+  BasicMatrix result = *this;
+  return result += a;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> BasicMatrix<T, Rows, Cols>::operator-(const BasicMatrix &a) const {
+  BasicMatrix result = *this;
+  return result -= a;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> BasicMatrix<T, Rows, Cols>::operator*(const T &number) const {
+  BasicMatrix result = *this;
+  return result *= number;
+}
+
+template <class T, size_t Rows, size_t Cols>
+template <size_t K>
+constexpr BasicMatrix<T, Rows, K> BasicMatrix<T, Rows, Cols>::operator*(
+    const BasicMatrix<T, Cols, K> &a) const {
+  BasicMatrix<T, Rows, K> result = BasicMatrix<T, Rows, K>::zero();
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows; ++i) {
+#pragma GCC unroll 16
+    for (size_t k = 0; k < Cols; ++k) {
+      T left = this->values[i * Cols + k];
+#pragma GCC unroll 16
+      for (size_t j = 0; j < K; ++j) {
+        result[i][j] += left * a[k][j];
+      }
+    }
+  }
+  return result;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> BasicMatrix<T, Rows, Cols>::operator-() const {
+  BasicMatrix result = *this;
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows * Cols; ++i) {
+    result.values[i] = -result.values[i];
+  }
+  return result;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Rows, Cols> BasicMatrix<T, Rows, Cols>::operator+() const {
+  return *this;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr T BasicMatrix<T, Rows, Cols>::det() const {
+  if (Rows != Cols) {
+    throw SizeMismatchException();
+  }
+  const T *a = this->values;
+  if constexpr (Rows == 1 && Cols == 1) {
+    return a[0];
+  } else if constexpr (Rows == 2 && Cols == 2) {
+    return a[0] * a[3] - a[1] * a[2];
+  } else if constexpr (Rows == 3 && Cols == 3) {
+    return a[0] * (a[4] * a[8] - a[5] * a[7])
+        - a[1] * (a[3] * a[8] - a[5] * a[6])
+        + a[2] * (a[3] * a[7] - a[4] * a[6]);
+  } else {
+    T copy[Rows * Cols]{};
+    for (size_t i = 0; i < Rows * Cols; ++i) {
+      copy[i] = a[i];
+    }
+    return detail::determinant(copy, Rows);
+  }
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr BasicMatrix<T, Cols, Rows> BasicMatrix<T, Rows, Cols>::transposed() const {
+  BasicMatrix<T, Cols, Rows> result;
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows; ++i) {
+#pragma GCC unroll 16
+    for (size_t j = 0; j < Cols; ++j) {
+      result[j][i] = this->values[i * Cols + j];
+    }
+  }
+  return result;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr T BasicMatrix<T, Rows, Cols>::trace() const {
+  if (Rows != Cols) {
+    throw SizeMismatchException();
+  }
+  T t = T(0);
+#pragma GCC unroll 16
+  for (size_t i = 0; i < Rows; ++i) {
+    t += this->values[i * Cols + i];
+  }
+  return t;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr bool BasicMatrix<T, Rows, Cols>::operator==(const BasicMatrix &a) const {
+  for (size_t i = 0; i < Rows * Cols; ++i) {
+    if (!detail::nearly_equal(this->values[i], a.values[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class T, size_t Rows, size_t Cols>
+constexpr bool BasicMatrix<T, Rows, Cols>::operator!=(const BasicMatrix &a) const {
+  return !(*this == a);
+}
+
+template <class T, size_t Rows, size_t Cols>
+Matrix BasicMatrix<T, Rows, Cols>::to_matrix() const {
+  Matrix result(Rows, Cols);
+  for (size_t i = 0; i < Rows; ++i) {
+    for (size_t j = 0; j < Cols; ++j) {
+      result[i][j] = static_cast<double>(this->values[i * Cols + j]);
+    }
+  }
+  return result;
+}
+
+// ---- dynamic size ----
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic>::BasicMatrix() : BasicMatrix(1, 1) {}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic>::BasicMatrix(size_t rows, size_t cols)
+    : rows(rows), cols(cols), array(new T[rows * cols]()) {
+  for (size_t i = 0; i < rows && i < cols; ++i) {
+    *(this->array + i * cols + i) = T(1);
+  }
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic>::BasicMatrix(const Matrix &matrix)
+    : rows(matrix.n_rows()), cols(matrix.n_cols()), array(new T[matrix.n_rows() * matrix.n_cols()]) {
+  for (size_t i = 0; i < this->rows; ++i) {
+    for (size_t j = 0; j < this->cols; ++j) {
+      *(this->array + i * this->cols + j) = static_cast<T>(matrix.at(i, j));
+    }
+  }
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic>::BasicMatrix(const BasicMatrix &copy)
+    : rows(copy.rows), cols(copy.cols), array(new T[copy.rows * copy.cols]) {
+  std::copy(copy.array, copy.array + this->rows * this->cols, this->array);
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic>::BasicMatrix(BasicMatrix &&other) noexcept
+    : rows(other.rows), cols(other.cols), array(other.array) {
+  other.rows = 0;
+  other.cols = 0;
+  other.array = nullptr;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> &BasicMatrix<T, Dynamic, Dynamic>::operator=(const BasicMatrix &a) {
+  if (this != &a) {
+    BasicMatrix tmp_matrix(a);
+    swap(tmp_matrix);
+  }
+  return *this;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> &BasicMatrix<T, Dynamic, Dynamic>::operator=(BasicMatrix &&other) noexcept {
+  if (this != &other) {
+    BasicMatrix tmp_matrix(std::move(other));
+    swap(tmp_matrix);
+  }
+  return *this;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic>::~BasicMatrix() {
+  delete[] this->array;
+}
+
+template <class T>
+void BasicMatrix<T, Dynamic, Dynamic>::swap(BasicMatrix &other) noexcept {
+  std::swap(this->rows, other.rows);
+  std::swap(this->cols, other.cols);
+  std::swap(this->array, other.array);
+}
+
+template <class T>
+size_t BasicMatrix<T, Dynamic, Dynamic>::n_rows() const {
+  return this->rows;
+}
+
+template <class T>
+size_t BasicMatrix<T, Dynamic, Dynamic>::n_cols() const {
+  return this->cols;
+}
+
+template <class T>
+T &BasicMatrix<T, Dynamic, Dynamic>::get(size_t row, size_t col) {
+  if (row >= this->rows || col >= this->cols) {
+    throw OutOfBoundsException();
+  }
+  return *(this->array + row * this->cols + col);
+}
+
+template <class T>
+const T &BasicMatrix<T, Dynamic, Dynamic>::get(size_t row, size_t col) const {
+  if (row >= this->rows || col >= this->cols) {
+    throw OutOfBoundsException();
+  }
+  return *(this->array + row * this->cols + col);
+}
+
+template <class T>
+void BasicMatrix<T, Dynamic, Dynamic>::set(size_t row, size_t col, const T &value) {
+  get(row, col) = value;
+}
+
+template <class T>
+T *BasicMatrix<T, Dynamic, Dynamic>::operator[](size_t row) {
+  return this->array + row * this->cols;
+}
+
+template <class T>
+const T *BasicMatrix<T, Dynamic, Dynamic>::operator[](size_t row) const {
+  return this->array + row * this->cols;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> &BasicMatrix<T, Dynamic, Dynamic>::operator+=(const BasicMatrix &a) {
+  if (this->rows != a.rows || this->cols != a.cols) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < this->rows * this->cols; ++i) {
+    *(this->array + i) += *(a.array + i);
+  }
+  return *this;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> &BasicMatrix<T, Dynamic, Dynamic>::operator-=(const BasicMatrix &a) {
+  if (this->rows != a.rows || this->cols != a.cols) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < this->rows * this->cols; ++i) {
+    *(this->array + i) -= *(a.array + i);
+  }
+  return *this;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> &BasicMatrix<T, Dynamic, Dynamic>::operator*=(const T &number) {
+  for (size_t i = 0; i < this->rows * this->cols; ++i) {
+    *(this->array + i) *= number;
+  }
+  return *this;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> &BasicMatrix<T, Dynamic, Dynamic>::operator*=(const BasicMatrix &a) {
+  BasicMatrix product = *this * a;
+  swap(product);
+  return *this;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::operator+(const BasicMatrix &a) const {
+  BasicMatrix tmp_matrix = *this;
+  tmp_matrix += a;
+  return tmp_matrix;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::operator-(const BasicMatrix &a) const {
+  BasicMatrix tmp_matrix = *this;
+  tmp_matrix -= a;
+  return tmp_matrix;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::operator*(const T &number) const {
+  BasicMatrix tmp_matrix = *this;
+  tmp_matrix *= number;
+  return tmp_matrix;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::operator*(const BasicMatrix &a) const {
+  if (this->cols != a.rows) {
+    throw SizeMismatchException();
+  }
+  BasicMatrix tmp_matrix(this->rows, a.cols);
+  std::fill(tmp_matrix.array, tmp_matrix.array + this->rows * a.cols, T(0));
+  if constexpr (std::is_same<T, double>::value) {
+    gemm(this->rows, a.cols, this->cols, 1.0, this->array, this->cols, a.array, a.cols,
+         tmp_matrix.array, a.cols);
+  } else {
+    for (size_t i = 0; i < this->rows; ++i) {
+      T *row = tmp_matrix.array + i * a.cols;
+      for (size_t k = 0; k < this->cols; ++k) {
+        T left = *(this->array + i * this->cols + k);
+        const T *other_row = a.array + k * a.cols;
+        for (size_t j = 0; j < a.cols; ++j) {
+          *(row + j) += left * *(other_row + j);
+        }
+      }
+    }
+  }
+  return tmp_matrix;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::operator-() const {
+  BasicMatrix tmp_matrix = *this;
+  for (size_t i = 0; i < this->rows * this->cols; ++i) {
+    *(tmp_matrix.array + i) = -*(tmp_matrix.array + i);
+  }
+  return tmp_matrix;
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::operator+() const {
+  return *this;
+}
+
+template <class T>
+T BasicMatrix<T, Dynamic, Dynamic>::det() const {
+  if (this->rows != this->cols) {
+    throw SizeMismatchException();
+  }
+  BasicMatrix tmp_matrix = *this;
+  return detail::determinant(tmp_matrix.array, this->rows);
+}
+
+template <class T>
+void BasicMatrix<T, Dynamic, Dynamic>::transpose() {
+  BasicMatrix tmp_matrix = transposed();
+  swap(tmp_matrix);
+}
+
+template <class T>
+BasicMatrix<T, Dynamic, Dynamic> BasicMatrix<T, Dynamic, Dynamic>::transposed() const {
+  BasicMatrix tmp_matrix(this->cols, this->rows);
+  for (size_t i = 0; i < this->rows; ++i) {
+    for (size_t j = 0; j < this->cols; ++j) {
+      *(tmp_matrix.array + j * this->rows + i) = *(this->array + i * this->cols + j);
+    }
+  }
+  return tmp_matrix;
+}
+
+template <class T>
+T BasicMatrix<T, Dynamic, Dynamic>::trace() const {
+  if (this->rows != this->cols) {
+    throw SizeMismatchException();
+  }
+  T t = T(0);
+  for (size_t i = 0; i < this->rows; ++i) {
+    t += *(this->array + i * this->cols + i);
+  }
+  return t;
+}
+
+template <class T>
+bool BasicMatrix<T, Dynamic, Dynamic>::operator==(const BasicMatrix &a) const {
+  if (this->rows != a.rows || this->cols != a.cols) {
+    return false;
+  }
+  for (size_t i = 0; i < this->rows * this->cols; ++i) {
+    if (!detail::nearly_equal(*(this->array + i), *(a.array + i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class T>
+bool BasicMatrix<T, Dynamic, Dynamic>::operator!=(const BasicMatrix &a) const {
+  return !(*this == a);
+}
+
+template <class T>
+Matrix BasicMatrix<T, Dynamic, Dynamic>::to_matrix() const {
+  Matrix result(this->rows, this->cols);
+  for (size_t i = 0; i < this->rows; ++i) {
+    for (size_t j = 0; j < this->cols; ++j) {
+      result[i][j] = static_cast<double>(*(this->array + i * this->cols + j));
+    }
+  }
+  return result;
+}
+
+}  // namespace task
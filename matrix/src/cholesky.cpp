@@ -0,0 +1,107 @@
+#include "cholesky.h"
+#include <algorithm>
+#include <cmath>
+#include "gemm.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include "triangular.h"
+
+using namespace task;
+
+Cholesky::Cholesky(const Matrix &a) : l(a) {
+  if (a.n_rows() != a.n_cols()) {
+    throw SizeMismatchException();
+  }
+  factorize();
+}
+
+// Right-looking blocked factorization: each CHOLESKY_BLOCK-wide panel is factorized column by
+// column, then the lower triangle of the trailing matrix gets A22 -= L21 * L21^T through gemm,
+// one independent block row per task.
+void Cholesky::factorize() {
+  size_t n = this->l.n_rows();
+  size_t ld = this->l.leading_dim();
+  double *a = this->l.data();
+  for (size_t k0 = 0; k0 < n; k0 += CHOLESKY_BLOCK) {
+    size_t k_end = std::min(n, k0 + CHOLESKY_BLOCK);
+    for (size_t k = k0; k < k_end; ++k) {
+      double pivot = *(a + k * ld + k);
+      if (!(pivot > 0)) {
+        throw NotPositiveDefiniteException();
+      }
+      double diagonal = std::sqrt(pivot);
+      *(a + k * ld + k) = diagonal;
+      // Panel rows are read by every other row below, so their entries are scaled up front.
+      for (size_t i = k + 1; i < k_end; ++i) {
+        *(a + i * ld + k) /= diagonal;
+      }
+      parallel_for(k + 1, n, (n - k) * (k_end - k), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          double *row = a + i * ld;
+          if (i >= k_end) {
+            *(row + k) /= diagonal;
+          }
+          size_t j_end = std::min(i + 1, k_end);
+          for (size_t j = k + 1; j < j_end; ++j) {
+            *(row + j) -= *(row + k) * *(a + j * ld + k);
+          }
+        }
+      });
+    }
+    if (k_end == n) {
+      break;
+    }
+    size_t blocks = (n - k_end + CHOLESKY_BLOCK - 1) / CHOLESKY_BLOCK;
+    size_t kb = k_end - k0;
+    parallel_for(0, blocks, (n - k_end) * (n - k_end) * kb / 2, [&](size_t first, size_t last) {
+      for (size_t block = first; block < last; ++block) {
+        size_t i0 = k_end + block * CHOLESKY_BLOCK;
+        size_t i_end = std::min(n, i0 + CHOLESKY_BLOCK);
+        gemm(GemmOp::None, GemmOp::Transpose, i_end - i0, i_end - k_end, kb, -1.0,
+             a + i0 * ld + k0, ld,
+             a + k_end * ld + k0, ld,
+             a + i0 * ld + k_end, ld);
+      }
+    });
+  }
+  for (size_t i = 0; i < n; ++i) {
+    std::fill(a + i * ld + i + 1, a + i * ld + n, 0.0);
+  }
+}
+
+double Cholesky::det() const {
+  double d = 1;
+  for (size_t i = 0; i < size(); ++i) {
+    d *= this->l.get(i, i);
+  }
+  return d * d;
+}
+
+Matrix Cholesky::solve(const Matrix &b) const {
+  size_t n = size();
+  if (b.n_rows() != n) {
+    throw SizeMismatchException();
+  }
+  Matrix x = b;
+  trsm(Triangle::Lower, GemmOp::None, false, n, x.n_cols(), this->l.data(),
+       this->l.leading_dim(), x.data(), x.leading_dim());
+  trsm(Triangle::Lower, GemmOp::Transpose, false, n, x.n_cols(), this->l.data(),
+       this->l.leading_dim(), x.data(), x.leading_dim());
+  return x;
+}
+
+std::vector<double> Cholesky::solve(const std::vector<double> &b) const {
+  return column_values(solve(column_matrix(b)));
+}
+
+Matrix Cholesky::inverse() const {
+  return solve(Matrix(size(), size()));
+}
+
+size_t Cholesky::size() const {
+  return this->l.n_rows();
+}
+
+const Matrix &Cholesky::factor() const {
+  return this->l;
+}
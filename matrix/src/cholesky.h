@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "matrix.h"
+
+namespace task {
+
+const size_t CHOLESKY_BLOCK = 64;
+
+// A = L * L^T for a symmetric positive definite matrix; only the lower triangle of A is read.
+// Throws NotPositiveDefiniteException when a pivot is not positive.
+class Cholesky {
+
+ public:
+
+  explicit Cholesky(const Matrix &a);
+
+  double det() const;
+  Matrix solve(const Matrix &b) const;
+  std::vector<double> solve(const std::vector<double> &b) const;
+  Matrix inverse() const;
+  size_t size() const;
+
+  // L with its strictly upper triangle zeroed.
+  const Matrix &factor() const;
+
+ private:
+
+  void factorize();
+
+  Matrix l;
+
+};
+
+}  // namespace task
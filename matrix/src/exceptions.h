@@ -0,0 +1,13 @@
+#pragma once
+
+#include <exception>
+
+namespace task {
+
+class OutOfBoundsException : public std::exception {};
+class SizeMismatchException : public std::exception {};
+class MatrixFileException : public std::exception {};
+class SingularMatrixException : public std::exception {};
+class NotPositiveDefiniteException : public std::exception {};
+
+}  // namespace task
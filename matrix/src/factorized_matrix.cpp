@@ -0,0 +1,165 @@
+#include "factorized_matrix.h"
+#include <cmath>
+#include "gemm.h"
+#include "kernels.h"
+
+using namespace task;
+
+namespace {
+
+double dot(const double *x, const double *y, size_t n) {
+  double sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += *(x + i) * *(y + i);
+  }
+  return sum;
+}
+
+}  // namespace
+
+FactorizedMatrix::FactorizedMatrix(const Matrix &a)
+    : a(a), lu(a), singular(false), determinant(0), corrections(0, a.n_cols()),
+      directions(0, a.n_cols()) {
+  reset();
+}
+
+void FactorizedMatrix::refactorize() {
+  this->lu = LU(this->a);
+  reset();
+}
+
+void FactorizedMatrix::reset() {
+  this->determinant = this->lu.det();
+  this->singular = this->lu.is_singular();
+  this->corrections.resize(0, size());
+  this->directions.resize(0, size());
+  this->denominators.clear();
+}
+
+void FactorizedMatrix::check_vector(const std::vector<double> &values) const {
+  if (values.size() != size()) {
+    throw SizeMismatchException();
+  }
+}
+
+// a already holds the updated matrix; the correction only depends on the factorization.
+void FactorizedMatrix::fold(const std::vector<double> &u, const std::vector<double> &v) {
+  size_t n = size();
+  if (this->singular || this->denominators.size() >= n) {
+    refactorize();
+    return;
+  }
+  std::vector<double> z = solve(u);
+  double denominator = 1 + dot(v.data(), z.data(), n);
+  double scale = std::sqrt(dot(v.data(), v.data(), n) * dot(z.data(), z.data(), n));
+  if (std::fabs(denominator) <= FACTORIZED_UPDATE_TOL * scale) {
+    refactorize();
+    return;
+  }
+  size_t k = this->denominators.size();
+  this->corrections.resize(k + 1, n);
+  this->directions.resize(k + 1, n);
+  std::copy(z.begin(), z.end(), this->corrections[k]);
+  std::copy(v.begin(), v.end(), this->directions[k]);
+  this->denominators.push_back(denominator);
+  this->determinant *= denominator;
+}
+
+void FactorizedMatrix::rank_one_update(const std::vector<double> &u,
+                                       const std::vector<double> &v) {
+  check_vector(u);
+  check_vector(v);
+  gemm(size(), size(), 1, 1.0, u.data(), 1, v.data(), size(), this->a.data(),
+       this->a.leading_dim());
+  fold(u, v);
+}
+
+void FactorizedMatrix::replace_row(size_t row, const std::vector<double> &values) {
+  if (row >= size()) {
+    throw OutOfBoundsException();
+  }
+  check_vector(values);
+  std::vector<double> u(size(), 0.0);
+  std::vector<double> v(values);
+  u[row] = 1;
+  kernels::sub(v.data(), this->a[row], size());
+  std::copy(values.begin(), values.end(), this->a[row]);
+  fold(u, v);
+}
+
+void FactorizedMatrix::replace_column(size_t col, const std::vector<double> &values) {
+  if (col >= size()) {
+    throw OutOfBoundsException();
+  }
+  check_vector(values);
+  std::vector<double> u(values);
+  std::vector<double> v(size(), 0.0);
+  v[col] = 1;
+  for (size_t i = 0; i < size(); ++i) {
+    u[i] -= this->a.at(i, col);
+    this->a[i][col] = values[i];
+  }
+  fold(u, v);
+}
+
+double FactorizedMatrix::det() const {
+  return this->determinant;
+}
+
+// x = A_0^-1 b, then x -= z_i (v_i^T x) / d_i for every update in order.
+Matrix FactorizedMatrix::solve(const Matrix &b) const {
+  Matrix x = this->lu.solve(b);
+  size_t n = size();
+  size_t r = x.n_cols();
+  std::vector<double> w(r);
+  for (size_t i = 0; i < this->denominators.size(); ++i) {
+    std::fill(w.begin(), w.end(), 0.0);
+    gemm(1, r, n, 1.0, this->directions[i], n, x.data(), x.leading_dim(), w.data(), r);
+    gemm(n, r, 1, -1.0 / this->denominators[i], this->corrections[i], 1, w.data(), r, x.data(),
+         x.leading_dim());
+  }
+  return x;
+}
+
+// Substitution with the factors row by row: one right-hand side does not fill trsm's blocks.
+void FactorizedMatrix::base_solve(std::vector<double> &x) const {
+  if (this->singular) {
+    throw SingularMatrixException();
+  }
+  size_t n = size();
+  const std::vector<size_t> &pivot = this->lu.pivots();
+  for (size_t k = 0; k < n; ++k) {
+    std::swap(x[k], x[pivot[k]]);
+  }
+  const Matrix &factors = this->lu.factors();
+  for (size_t i = 1; i < n; ++i) {
+    x[i] -= dot(factors[i], x.data(), i);
+  }
+  for (size_t i = n; i > 0; --i) {
+    const double *row = factors[i - 1];
+    x[i - 1] = (x[i - 1] - dot(row + i, x.data() + i, n - i)) / *(row + i - 1);
+  }
+}
+
+std::vector<double> FactorizedMatrix::solve(const std::vector<double> &b) const {
+  check_vector(b);
+  std::vector<double> x(b);
+  base_solve(x);
+  for (size_t i = 0; i < this->denominators.size(); ++i) {
+    double factor = dot(this->directions[i], x.data(), size()) / this->denominators[i];
+    kernels::axpy(x.data(), -factor, this->corrections[i], size());
+  }
+  return x;
+}
+
+size_t FactorizedMatrix::size() const {
+  return this->a.n_rows();
+}
+
+size_t FactorizedMatrix::pending_updates() const {
+  return this->denominators.size();
+}
+
+const Matrix &FactorizedMatrix::matrix() const {
+  return this->a;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include "lu.h"
+#include "matrix.h"
+
+namespace task {
+
+// Updates with |1 + v^T A^-1 u| below this fraction of |v| * |A^-1 u| refactorize instead.
+const double FACTORIZED_UPDATE_TOL = 1e-8;
+
+// Square matrix kept together with its LU factorization under rank-1 changes. Each change
+// A += u * v^T is folded in by the matrix determinant lemma and Sherman-Morrison in O(n^2):
+// the LU of an earlier matrix is kept along with the corrections since, and the matrix is
+// refactorized once n corrections have piled up, so det() stays O(1) and solve O(n^2)
+// amortized. Ill-conditioned updates and singular matrices refactorize right away.
+class FactorizedMatrix {
+
+ public:
+
+  // Throws SizeMismatchException unless a is square.
+  explicit FactorizedMatrix(const Matrix &a);
+
+  // A += u * v^T
+  void rank_one_update(const std::vector<double> &u, const std::vector<double> &v);
+  void replace_row(size_t row, const std::vector<double> &values);
+  void replace_column(size_t col, const std::vector<double> &values);
+  void refactorize();
+
+  double det() const;
+  // A^-1 B for every column of B (or for b); throws SingularMatrixException when A is singular
+  // by LU::is_singular, i.e. has a pivot below EPS.
+  Matrix solve(const Matrix &b) const;
+  std::vector<double> solve(const std::vector<double> &b) const;
+  size_t size() const;
+  size_t pending_updates() const;
+
+  const Matrix &matrix() const;
+
+ private:
+
+  void check_vector(const std::vector<double> &values) const;
+  void reset();
+  void base_solve(std::vector<double> &x) const;
+  void fold(const std::vector<double> &u, const std::vector<double> &v);
+
+  Matrix a;
+  LU lu;
+  bool singular;
+  double determinant;
+  // Row i holds A_i^-1 u_i for the matrix A_i before update i.
+  Matrix corrections;
+  // Row i holds v_i.
+  Matrix directions;
+  // 1 + v_i^T A_i^-1 u_i
+  std::vector<double> denominators;
+
+};
+
+}  // namespace task
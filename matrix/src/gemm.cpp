@@ -0,0 +1,284 @@
+#include "gemm.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <new>
+#include <immintrin.h>
+
+using namespace task;
+
+namespace {
+
+const size_t PACK_ALIGNMENT = 64;
+const size_t MAX_MR = 8;
+const size_t MAX_NR = 16;
+
+struct PackBuffer {
+
+  double *buffer = nullptr;
+  size_t capacity = 0;
+
+  double *reserve(size_t count) {
+    if (count > this->capacity) {
+      release();
+      this->buffer = static_cast<double *>(::operator new(count * sizeof(double),
+                                                          std::align_val_t(PACK_ALIGNMENT)));
+      this->capacity = count;
+    }
+    return this->buffer;
+  }
+
+  void release() {
+    if (this->buffer != nullptr) {
+      ::operator delete(this->buffer, std::align_val_t(PACK_ALIGNMENT));
+    }
+    this->buffer = nullptr;
+    this->capacity = 0;
+  }
+
+  ~PackBuffer() {
+    release();
+  }
+
+};
+
+// Computes the full mr x nr tile acc = A_panel * B_panel over kc steps.
+using MicroKernel = void (*)(size_t kc, const double *a, const double *b, double *acc);
+
+struct KernelSet {
+  size_t mr;
+  size_t nr;
+  MicroKernel kernel;
+};
+
+void micro_kernel_generic(size_t kc, const double *a, const double *b, double *acc) {
+  const size_t mr = 4;
+  const size_t nr = 8;
+  double tile[mr][nr] = {};
+  for (size_t p = 0; p < kc; ++p) {
+    for (size_t r = 0; r < mr; ++r) {
+      double a_value = *(a + r);
+      for (size_t col = 0; col < nr; ++col) {
+        tile[r][col] += a_value * *(b + col);
+      }
+    }
+    a += mr;
+    b += nr;
+  }
+  for (size_t r = 0; r < mr; ++r) {
+    for (size_t col = 0; col < nr; ++col) {
+      *(acc + r * nr + col) = tile[r][col];
+    }
+  }
+}
+
+__attribute__((target("avx2,fma")))
+void micro_kernel_avx2(size_t kc, const double *a, const double *b, double *acc) {
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+  __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+  for (size_t p = 0; p < kc; ++p) {
+    __m256d b0 = _mm256_load_pd(b);
+    __m256d b1 = _mm256_load_pd(b + 4);
+    __m256d a_value = _mm256_broadcast_sd(a);
+    c00 = _mm256_fmadd_pd(a_value, b0, c00);
+    c01 = _mm256_fmadd_pd(a_value, b1, c01);
+    a_value = _mm256_broadcast_sd(a + 1);
+    c10 = _mm256_fmadd_pd(a_value, b0, c10);
+    c11 = _mm256_fmadd_pd(a_value, b1, c11);
+    a_value = _mm256_broadcast_sd(a + 2);
+    c20 = _mm256_fmadd_pd(a_value, b0, c20);
+    c21 = _mm256_fmadd_pd(a_value, b1, c21);
+    a_value = _mm256_broadcast_sd(a + 3);
+    c30 = _mm256_fmadd_pd(a_value, b0, c30);
+    c31 = _mm256_fmadd_pd(a_value, b1, c31);
+    a_value = _mm256_broadcast_sd(a + 4);
+    c40 = _mm256_fmadd_pd(a_value, b0, c40);
+    c41 = _mm256_fmadd_pd(a_value, b1, c41);
+    a_value = _mm256_broadcast_sd(a + 5);
+    c50 = _mm256_fmadd_pd(a_value, b0, c50);
+    c51 = _mm256_fmadd_pd(a_value, b1, c51);
+    a += 6;
+    b += 8;
+  }
+  _mm256_storeu_pd(acc + 0, c00);
+  _mm256_storeu_pd(acc + 4, c01);
+  _mm256_storeu_pd(acc + 8, c10);
+  _mm256_storeu_pd(acc + 12, c11);
+  _mm256_storeu_pd(acc + 16, c20);
+  _mm256_storeu_pd(acc + 20, c21);
+  _mm256_storeu_pd(acc + 24, c30);
+  _mm256_storeu_pd(acc + 28, c31);
+  _mm256_storeu_pd(acc + 32, c40);
+  _mm256_storeu_pd(acc + 36, c41);
+  _mm256_storeu_pd(acc + 40, c50);
+  _mm256_storeu_pd(acc + 44, c51);
+}
+
+__attribute__((target("avx512f")))
+void micro_kernel_avx512(size_t kc, const double *a, const double *b, double *acc) {
+  __m512d c[8][2];
+  for (size_t r = 0; r < 8; ++r) {
+    c[r][0] = _mm512_setzero_pd();
+    c[r][1] = _mm512_setzero_pd();
+  }
+  for (size_t p = 0; p < kc; ++p) {
+    __m512d b0 = _mm512_load_pd(b);
+    __m512d b1 = _mm512_load_pd(b + 8);
+    for (size_t r = 0; r < 8; ++r) {
+      __m512d a_value = _mm512_set1_pd(*(a + r));
+      c[r][0] = _mm512_fmadd_pd(a_value, b0, c[r][0]);
+      c[r][1] = _mm512_fmadd_pd(a_value, b1, c[r][1]);
+    }
+    a += 8;
+    b += 16;
+  }
+  for (size_t r = 0; r < 8; ++r) {
+    _mm512_storeu_pd(acc + r * 16, c[r][0]);
+    _mm512_storeu_pd(acc + r * 16 + 8, c[r][1]);
+  }
+}
+
+const KernelSet &select_kernels() {
+  static const KernelSet kernels = []() -> KernelSet {
+    switch (simd_level()) {
+      case SimdLevel::AVX512:
+        return {8, 16, micro_kernel_avx512};
+      case SimdLevel::AVX2:
+        return {6, 8, micro_kernel_avx2};
+      default:
+        return {4, 8, micro_kernel_generic};
+    }
+  }();
+  return kernels;
+}
+
+// Element (i, j) of an operand lives at data[i * row_step + j * col_step], which covers
+// both a row-major matrix and a transposed read of one.
+struct Operand {
+  const double *data;
+  size_t row_step;
+  size_t col_step;
+
+  const double *at(size_t row, size_t col) const {
+    return this->data + row * this->row_step + col * this->col_step;
+  }
+};
+
+Operand make_operand(GemmOp op, const double *data, size_t ld) {
+  if (op == GemmOp::Transpose) {
+    return {data, 1, ld};
+  }
+  return {data, ld, 1};
+}
+
+// Packs an mc x kc block of A into mr-row panels stored k-major; short panels are zero padded.
+void pack_a(size_t mc, size_t kc, const Operand &a, size_t mr, double *packed) {
+  for (size_t i = 0; i < mc; i += mr) {
+    size_t rows = std::min(mr, mc - i);
+    for (size_t p = 0; p < kc; ++p) {
+      for (size_t r = 0; r < rows; ++r) {
+        *(packed + r) = *a.at(i + r, p);
+      }
+      for (size_t r = rows; r < mr; ++r) {
+        *(packed + r) = 0;
+      }
+      packed += mr;
+    }
+  }
+}
+
+// Packs a kc x nc block of B into nr-column panels stored k-major; short panels are zero padded.
+void pack_b(size_t kc, size_t nc, const Operand &b, size_t nr, double *packed) {
+  for (size_t j = 0; j < nc; j += nr) {
+    size_t cols = std::min(nr, nc - j);
+    for (size_t p = 0; p < kc; ++p) {
+      const double *source = b.at(p, j);
+      if (b.col_step == 1) {
+        std::copy(source, source + cols, packed);
+      } else {
+        for (size_t col = 0; col < cols; ++col) {
+          *(packed + col) = *(source + col * b.col_step);
+        }
+      }
+      for (size_t col = cols; col < nr; ++col) {
+        *(packed + col) = 0;
+      }
+      packed += nr;
+    }
+  }
+}
+
+void macro_kernel(const KernelSet &kernels, size_t mc, size_t nc, size_t kc, double alpha,
+                  const double *packed_a, const double *packed_b, double *c, size_t ldc) {
+  alignas(PACK_ALIGNMENT) double acc[MAX_MR * MAX_NR];
+  for (size_t j = 0; j < nc; j += kernels.nr) {
+    size_t cols = std::min(kernels.nr, nc - j);
+    for (size_t i = 0; i < mc; i += kernels.mr) {
+      size_t rows = std::min(kernels.mr, mc - i);
+      kernels.kernel(kc, packed_a + i * kc, packed_b + j * kc, acc);
+      double *tile = c + i * ldc + j;
+      for (size_t r = 0; r < rows; ++r) {
+        for (size_t col = 0; col < cols; ++col) {
+          *(tile + r * ldc + col) += alpha * *(acc + r * kernels.nr + col);
+        }
+      }
+    }
+  }
+}
+
+size_t round_up(size_t value, size_t step) {
+  return (value + step - 1) / step * step;
+}
+
+}  // namespace
+
+void task::gemm(size_t m, size_t n, size_t k, double alpha,
+                const double *a, size_t lda,
+                const double *b, size_t ldb,
+                double *c, size_t ldc) {
+  gemm(GemmOp::None, GemmOp::None, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+}
+
+void task::gemm(GemmOp op_a, GemmOp op_b, size_t m, size_t n, size_t k, double alpha,
+                const double *a, size_t lda,
+                const double *b, size_t ldb,
+                double *c, size_t ldc) {
+  if (m == 0 || n == 0 || k == 0) {
+    return;
+  }
+  Operand left = make_operand(op_a, a, lda);
+  Operand right = make_operand(op_b, b, ldb);
+  const KernelSet &kernels = select_kernels();
+  thread_local PackBuffer b_buffer;
+  double *packed_b = b_buffer.reserve(round_up(std::min(n, GEMM_NC), kernels.nr) * GEMM_KC);
+  size_t m_blocks = (m + GEMM_MC - 1) / GEMM_MC;
+  for (size_t jc = 0; jc < n; jc += GEMM_NC) {
+    size_t nc = std::min(GEMM_NC, n - jc);
+    size_t n_panels = (nc + kernels.nr - 1) / kernels.nr;
+    for (size_t pc = 0; pc < k; pc += GEMM_KC) {
+      size_t kc = std::min(GEMM_KC, k - pc);
+      parallel_for(0, n_panels, nc * kc, [&](size_t first, size_t last) {
+        size_t j = first * kernels.nr;
+        size_t cols = std::min(nc, last * kernels.nr) - j;
+        pack_b(kc, cols, Operand{right.at(pc, jc + j), right.row_step, right.col_step},
+               kernels.nr, packed_b + j * kc);
+      });
+      // Each task owns whole MC-row blocks of C, so the summation order never depends on threads.
+      parallel_for(0, m_blocks, m * nc * kc, [&](size_t first, size_t last) {
+        thread_local PackBuffer a_buffer;
+        double *packed_a = a_buffer.reserve(round_up(GEMM_MC, kernels.mr) * GEMM_KC);
+        for (size_t block = first; block < last; ++block) {
+          size_t ic = block * GEMM_MC;
+          size_t mc = std::min(GEMM_MC, m - ic);
+          pack_a(mc, kc, Operand{left.at(ic, pc), left.row_step, left.col_step},
+                 kernels.mr, packed_a);
+          macro_kernel(kernels, mc, nc, kc, alpha, packed_a, packed_b, c + ic * ldc + jc, ldc);
+        }
+      });
+    }
+  }
+}
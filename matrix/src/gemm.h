@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace task {
+
+const size_t GEMM_KC = 256;
+const size_t GEMM_MC = 96;
+const size_t GEMM_NC = 2048;
+
+// C += alpha * A * B for row-major operands with leading dimensions lda, ldb, ldc.
+// A is m x k, B is k x n, C is m x n.
+void gemm(size_t m, size_t n, size_t k, double alpha,
+          const double *a, size_t lda,
+          const double *b, size_t ldb,
+          double *c, size_t ldc);
+
+enum class GemmOp {
+  None,
+  Transpose
+};
+
+// C += alpha * op(A) * op(B), where op(X) is X or X^T read directly from X's storage.
+// op(A) is m x k and op(B) is k x n.
+void gemm(GemmOp op_a, GemmOp op_b, size_t m, size_t n, size_t k, double alpha,
+          const double *a, size_t lda,
+          const double *b, size_t ldb,
+          double *c, size_t ldc);
+
+}  // namespace task
@@ -0,0 +1,405 @@
+#include "kernels.h"
+#include <algorithm>
+#include <immintrin.h>
+
+using namespace task;
+
+namespace {
+
+struct KernelTable {
+  void (*add)(double *, const double *, size_t);
+  void (*sub)(double *, const double *, size_t);
+  void (*scale)(double *, double, size_t);
+  void (*negate)(double *, const double *, size_t);
+  void (*axpy)(double *, double, const double *, size_t);
+  bool (*equal)(const double *, const double *, size_t, double);
+  size_t block;
+  void (*transpose_block)(const double *, size_t, double *, size_t);
+};
+
+void add_sse2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), _mm_loadu_pd(src + i)));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) += *(src + i);
+  }
+}
+
+void sub_sse2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_sub_pd(_mm_loadu_pd(dst + i), _mm_loadu_pd(src + i)));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) -= *(src + i);
+  }
+}
+
+void scale_sse2(double *dst, double alpha, size_t n) {
+  __m128d factor = _mm_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(dst + i), factor));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) *= alpha;
+  }
+}
+
+void negate_sse2(double *dst, const double *src, size_t n) {
+  __m128d sign = _mm_set1_pd(-0.0);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_xor_pd(_mm_loadu_pd(src + i), sign));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = -*(src + i);
+  }
+}
+
+void axpy_sse2(double *dst, double alpha, const double *src, size_t n) {
+  __m128d factor = _mm_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d product = _mm_mul_pd(_mm_loadu_pd(src + i), factor);
+    _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), product));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) += alpha * *(src + i);
+  }
+}
+
+bool equal_tail(const double *a, const double *b, size_t from, size_t n, double eps) {
+  for (size_t i = from; i < n; ++i) {
+    double diff = *(a + i) - *(b + i);
+    if (diff > eps || -diff > eps) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool equal_sse2(const double *a, const double *b, size_t n, double eps) {
+  __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+  __m128d bound = _mm_set1_pd(eps);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d diff = _mm_and_pd(_mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)), abs_mask);
+    if (_mm_movemask_pd(_mm_cmpgt_pd(diff, bound)) != 0) {
+      return false;
+    }
+  }
+  return equal_tail(a, b, i, n, eps);
+}
+
+__attribute__((target("avx2")))
+void add_avx2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), _mm256_loadu_pd(src + i)));
+  }
+  add_sse2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void sub_avx2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(dst + i, _mm256_sub_pd(_mm256_loadu_pd(dst + i), _mm256_loadu_pd(src + i)));
+  }
+  sub_sse2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void scale_avx2(double *dst, double alpha, size_t n) {
+  __m256d factor = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(dst + i), factor));
+  }
+  scale_sse2(dst + i, alpha, n - i);
+}
+
+__attribute__((target("avx2")))
+void negate_avx2(double *dst, const double *src, size_t n) {
+  __m256d sign = _mm256_set1_pd(-0.0);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(dst + i, _mm256_xor_pd(_mm256_loadu_pd(src + i), sign));
+  }
+  negate_sse2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+void axpy_avx2(double *dst, double alpha, const double *src, size_t n) {
+  __m256d factor = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(dst + i, _mm256_fmadd_pd(_mm256_loadu_pd(src + i), factor,
+                                              _mm256_loadu_pd(dst + i)));
+  }
+  axpy_sse2(dst + i, alpha, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+bool equal_avx2(const double *a, const double *b, size_t n, double eps) {
+  __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+  __m256d bound = _mm256_set1_pd(eps);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d diff = _mm256_and_pd(_mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)),
+                                 abs_mask);
+    if (_mm256_movemask_pd(_mm256_cmp_pd(diff, bound, _CMP_GT_OQ)) != 0) {
+      return false;
+    }
+  }
+  return equal_tail(a, b, i, n, eps);
+}
+
+__attribute__((target("avx512f")))
+void add_avx512(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_add_pd(_mm512_loadu_pd(dst + i), _mm512_loadu_pd(src + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+    __m512d sum = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, dst + i),
+                                _mm512_maskz_loadu_pd(mask, src + i));
+    _mm512_mask_storeu_pd(dst + i, mask, sum);
+  }
+}
+
+__attribute__((target("avx512f")))
+void sub_avx512(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_sub_pd(_mm512_loadu_pd(dst + i), _mm512_loadu_pd(src + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+    __m512d diff = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, dst + i),
+                                 _mm512_maskz_loadu_pd(mask, src + i));
+    _mm512_mask_storeu_pd(dst + i, mask, diff);
+  }
+}
+
+__attribute__((target("avx512f")))
+void scale_avx512(double *dst, double alpha, size_t n) {
+  __m512d factor = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_mul_pd(_mm512_loadu_pd(dst + i), factor));
+  }
+  if (i < n) {
+    __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+    _mm512_mask_storeu_pd(dst + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, dst + i), factor));
+  }
+}
+
+__attribute__((target("avx512f")))
+void negate_avx512(double *dst, const double *src, size_t n) {
+  __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ULL));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i value = _mm512_castpd_si512(_mm512_loadu_pd(src + i));
+    _mm512_storeu_pd(dst + i, _mm512_castsi512_pd(_mm512_xor_si512(value, sign)));
+  }
+  if (i < n) {
+    __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+    __m512i value = _mm512_castpd_si512(_mm512_maskz_loadu_pd(mask, src + i));
+    _mm512_mask_storeu_pd(dst + i, mask, _mm512_castsi512_pd(_mm512_xor_si512(value, sign)));
+  }
+}
+
+__attribute__((target("avx512f")))
+void axpy_avx512(double *dst, double alpha, const double *src, size_t n) {
+  __m512d factor = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_fmadd_pd(_mm512_loadu_pd(src + i), factor,
+                                              _mm512_loadu_pd(dst + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+    __m512d result = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, src + i), factor,
+                                     _mm512_maskz_loadu_pd(mask, dst + i));
+    _mm512_mask_storeu_pd(dst + i, mask, result);
+  }
+}
+
+__attribute__((target("avx512f")))
+bool equal_avx512(const double *a, const double *b, size_t n, double eps) {
+  __m512d bound = _mm512_set1_pd(eps);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d diff = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    if (_mm512_cmp_pd_mask(diff, bound, _CMP_GT_OQ) != 0) {
+      return false;
+    }
+  }
+  return equal_tail(a, b, i, n, eps);
+}
+
+void transpose_block_scalar(const double *src, size_t lds, double *dst, size_t ldd) {
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      *(dst + j * ldd + i) = *(src + i * lds + j);
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+void transpose_block_avx2(const double *src, size_t lds, double *dst, size_t ldd) {
+  __m256d r0 = _mm256_loadu_pd(src);
+  __m256d r1 = _mm256_loadu_pd(src + lds);
+  __m256d r2 = _mm256_loadu_pd(src + 2 * lds);
+  __m256d r3 = _mm256_loadu_pd(src + 3 * lds);
+  __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+  __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+  __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+  __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+  _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+// GCC 12 intrinsics headers trip -Wuninitialized on _mm512_undefined_pd (GCC bug 105593).
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+__attribute__((target("avx512f")))
+void transpose_block_avx512(const double *src, size_t lds, double *dst, size_t ldd) {
+  __m512d t[8];
+  for (size_t i = 0; i < 8; i += 2) {
+    __m512d r0 = _mm512_loadu_pd(src + i * lds);
+    __m512d r1 = _mm512_loadu_pd(src + (i + 1) * lds);
+    t[i] = _mm512_unpacklo_pd(r0, r1);
+    t[i + 1] = _mm512_unpackhi_pd(r0, r1);
+  }
+  // u[0..3] hold columns {0,4}, {2,6}, {1,5}, {3,7} of rows 0-3, u[4..7] the same for rows 4-7.
+  __m512d u[8];
+  for (size_t half = 0; half < 8; half += 4) {
+    u[half] = _mm512_shuffle_f64x2(t[half], t[half + 2], 0x88);
+    u[half + 1] = _mm512_shuffle_f64x2(t[half], t[half + 2], 0xDD);
+    u[half + 2] = _mm512_shuffle_f64x2(t[half + 1], t[half + 3], 0x88);
+    u[half + 3] = _mm512_shuffle_f64x2(t[half + 1], t[half + 3], 0xDD);
+  }
+  _mm512_storeu_pd(dst, _mm512_shuffle_f64x2(u[0], u[4], 0x88));
+  _mm512_storeu_pd(dst + 4 * ldd, _mm512_shuffle_f64x2(u[0], u[4], 0xDD));
+  _mm512_storeu_pd(dst + 2 * ldd, _mm512_shuffle_f64x2(u[1], u[5], 0x88));
+  _mm512_storeu_pd(dst + 6 * ldd, _mm512_shuffle_f64x2(u[1], u[5], 0xDD));
+  _mm512_storeu_pd(dst + ldd, _mm512_shuffle_f64x2(u[2], u[6], 0x88));
+  _mm512_storeu_pd(dst + 5 * ldd, _mm512_shuffle_f64x2(u[2], u[6], 0xDD));
+  _mm512_storeu_pd(dst + 3 * ldd, _mm512_shuffle_f64x2(u[3], u[7], 0x88));
+  _mm512_storeu_pd(dst + 7 * ldd, _mm512_shuffle_f64x2(u[3], u[7], 0xDD));
+}
+#pragma GCC diagnostic pop
+
+const KernelTable &kernel_table() {
+  static const KernelTable table = []() -> KernelTable {
+    switch (simd_level()) {
+      case SimdLevel::AVX512:
+        return {add_avx512, sub_avx512, scale_avx512, negate_avx512, axpy_avx512, equal_avx512,
+                8, transpose_block_avx512};
+      case SimdLevel::AVX2:
+        return {add_avx2, sub_avx2, scale_avx2, negate_avx2, axpy_avx2, equal_avx2,
+                4, transpose_block_avx2};
+      default:
+        return {add_sse2, sub_sse2, scale_sse2, negate_sse2, axpy_sse2, equal_sse2,
+                4, transpose_block_scalar};
+    }
+  }();
+  return table;
+}
+
+}  // namespace
+
+SimdLevel task::simd_level() {
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+  }();
+  return level;
+}
+
+void task::kernels::add(double *dst, const double *src, size_t n) {
+  kernel_table().add(dst, src, n);
+}
+
+void task::kernels::sub(double *dst, const double *src, size_t n) {
+  kernel_table().sub(dst, src, n);
+}
+
+void task::kernels::scale(double *dst, double alpha, size_t n) {
+  kernel_table().scale(dst, alpha, n);
+}
+
+void task::kernels::negate(double *dst, const double *src, size_t n) {
+  kernel_table().negate(dst, src, n);
+}
+
+void task::kernels::axpy(double *dst, double alpha, const double *src, size_t n) {
+  kernel_table().axpy(dst, alpha, src, n);
+}
+
+bool task::kernels::equal(const double *a, const double *b, size_t n, double eps) {
+  return kernel_table().equal(a, b, n, eps);
+}
+
+void task::kernels::transpose(const double *src, size_t lds, double *dst, size_t ldd,
+                              size_t rows, size_t cols) {
+  const KernelTable &table = kernel_table();
+  for (size_t i0 = 0; i0 < rows; i0 += TRANSPOSE_TILE) {
+    size_t i_end = std::min(rows, i0 + TRANSPOSE_TILE);
+    for (size_t j0 = 0; j0 < cols; j0 += TRANSPOSE_TILE) {
+      size_t j_end = std::min(cols, j0 + TRANSPOSE_TILE);
+      size_t i = i0;
+      for (; i + table.block <= i_end; i += table.block) {
+        size_t j = j0;
+        for (; j + table.block <= j_end; j += table.block) {
+          table.transpose_block(src + i * lds + j, lds, dst + j * ldd + i, ldd);
+        }
+        for (; j < j_end; ++j) {
+          for (size_t r = i; r < i + table.block; ++r) {
+            *(dst + j * ldd + r) = *(src + r * lds + j);
+          }
+        }
+      }
+      for (; i < i_end; ++i) {
+        for (size_t j = j0; j < j_end; ++j) {
+          *(dst + j * ldd + i) = *(src + i * lds + j);
+        }
+      }
+    }
+  }
+}
+
+void task::kernels::transpose_square(double *a, size_t ld, size_t n,
+                                     size_t row_begin, size_t row_end) {
+  alignas(64) double tile[TRANSPOSE_TILE * TRANSPOSE_TILE];
+  for (size_t i0 = row_begin; i0 < row_end; i0 += TRANSPOSE_TILE) {
+    size_t rows = std::min(n, i0 + TRANSPOSE_TILE) - i0;
+    for (size_t j0 = i0; j0 < n; j0 += TRANSPOSE_TILE) {
+      size_t cols = std::min(n, j0 + TRANSPOSE_TILE) - j0;
+      double *upper = a + i0 * ld + j0;
+      double *lower = a + j0 * ld + i0;
+      // Park the transposed upper tile, move the lower tile up, then write the parked one down.
+      transpose(upper, ld, tile, TRANSPOSE_TILE, rows, cols);
+      if (j0 != i0) {
+        transpose(lower, ld, upper, ld, cols, rows);
+      }
+      for (size_t r = 0; r < cols; ++r) {
+        std::copy(tile + r * TRANSPOSE_TILE, tile + r * TRANSPOSE_TILE + rows, lower + r * ld);
+      }
+    }
+  }
+}
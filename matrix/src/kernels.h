@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace task {
+
+enum class SimdLevel {
+  SSE2,
+  AVX2,
+  AVX512
+};
+
+// Widest instruction set supported by the running CPU, detected once via cpuid.
+SimdLevel simd_level();
+
+namespace kernels {
+
+const size_t TRANSPOSE_TILE = 32;
+
+// dst[i] += src[i]
+void add(double *dst, const double *src, size_t n);
+// dst[i] -= src[i]
+void sub(double *dst, const double *src, size_t n);
+// dst[i] *= alpha
+void scale(double *dst, double alpha, size_t n);
+// dst[i] = -src[i]; dst may alias src
+void negate(double *dst, const double *src, size_t n);
+// dst[i] += alpha * src[i]
+void axpy(double *dst, double alpha, const double *src, size_t n);
+// true if |a[i] - b[i]| <= eps for every i
+bool equal(const double *a, const double *b, size_t n, double eps);
+
+// dst = src^T for a rows x cols src; the buffers must not overlap. Works tile by tile with
+// SIMD 8x8 (AVX-512) or 4x4 (AVX2) register transposes inside each tile.
+void transpose(const double *src, size_t lds, double *dst, size_t ldd, size_t rows, size_t cols);
+// Transposes the n x n matrix a in place, handling the tile rows that start in
+// [row_begin, row_end); row_begin must be a multiple of TRANSPOSE_TILE.
+void transpose_square(double *a, size_t ld, size_t n, size_t row_begin, size_t row_end);
+
+}  // namespace kernels
+
+}  // namespace task
@@ -0,0 +1,133 @@
+#include "lu.h"
+#include <algorithm>
+#include <cmath>
+#include "gemm.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include "triangular.h"
+
+using namespace task;
+
+LU::LU(const Matrix &a) : LU(a, default_matrix_resource()) {}
+
+LU::LU(const Matrix &a, std::pmr::memory_resource *resource)
+    : lu(a, resource), pivot(a.n_rows()), sign(1) {
+  if (a.n_rows() != a.n_cols()) {
+    throw SizeMismatchException();
+  }
+  factorize();
+}
+
+// Right-looking blocked factorization: each LU_BLOCK-wide panel is factorized column by column,
+// the block row of U is solved in place and the trailing matrix is updated through gemm.
+void LU::factorize() {
+  size_t n = this->lu.n_rows();
+  size_t ld = this->lu.leading_dim();
+  double *a = this->lu.data();
+  for (size_t k0 = 0; k0 < n; k0 += LU_BLOCK) {
+    size_t k_end = std::min(n, k0 + LU_BLOCK);
+    for (size_t k = k0; k < k_end; ++k) {
+      size_t p = k;
+      double best = std::fabs(*(a + k * ld + k));
+      for (size_t i = k + 1; i < n; ++i) {
+        double value = std::fabs(*(a + i * ld + k));
+        if (value > best) {
+          best = value;
+          p = i;
+        }
+      }
+      this->pivot[k] = p;
+      if (p != k) {
+        std::swap_ranges(a + k * ld, a + k * ld + n, a + p * ld);
+        this->sign = -this->sign;
+      }
+      double diagonal = *(a + k * ld + k);
+      if (diagonal == 0) {
+        continue;
+      }
+      parallel_for(k + 1, n, (n - k) * (k_end - k), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          double *row = a + i * ld;
+          *(row + k) /= diagonal;
+          kernels::axpy(row + k + 1, -*(row + k), a + k * ld + k + 1, k_end - k - 1);
+        }
+      });
+    }
+    if (k_end == n) {
+      break;
+    }
+    size_t solve_work = (n - k_end) * (k_end - k0) * (k_end - k0);
+    parallel_for(k_end, n, solve_work, [&](size_t first, size_t last) {
+      for (size_t k = k0; k < k_end; ++k) {
+        for (size_t i = k + 1; i < k_end; ++i) {
+          kernels::axpy(a + i * ld + first, -*(a + i * ld + k), a + k * ld + first, last - first);
+        }
+      }
+    });
+    gemm(n - k_end, n - k_end, k_end - k0, -1.0,
+         a + k_end * ld + k0, ld,
+         a + k0 * ld + k_end, ld,
+         a + k_end * ld + k_end, ld);
+  }
+}
+
+double LU::det() const {
+  double d = this->sign;
+  for (size_t i = 0; i < size(); ++i) {
+    d *= this->lu.get(i, i);
+  }
+  return d;
+}
+
+bool LU::is_singular() const {
+  for (size_t i = 0; i < size(); ++i) {
+    double diagonal = this->lu.get(i, i);
+    if (diagonal < EPS && -diagonal < EPS) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Matrix LU::solve(const Matrix &b) const {
+  size_t n = size();
+  if (b.n_rows() != n) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (this->lu.get(i, i) == 0) {
+      throw SingularMatrixException();
+    }
+  }
+  Matrix x = b;
+  for (size_t k = 0; k < n; ++k) {
+    if (this->pivot[k] != k) {
+      std::swap_ranges(x[k], x[k] + x.n_cols(), x[this->pivot[k]]);
+    }
+  }
+  trsm(Triangle::Lower, GemmOp::None, true, n, x.n_cols(), this->lu.data(),
+       this->lu.leading_dim(), x.data(), x.leading_dim());
+  trsm(Triangle::Upper, GemmOp::None, false, n, x.n_cols(), this->lu.data(),
+       this->lu.leading_dim(), x.data(), x.leading_dim());
+  return x;
+}
+
+std::vector<double> LU::solve(const std::vector<double> &b) const {
+  return column_values(solve(column_matrix(b)));
+}
+
+Matrix LU::inverse() const {
+  return solve(Matrix(size(), size()));
+}
+
+size_t LU::size() const {
+  return this->lu.n_rows();
+}
+
+const Matrix &LU::factors() const {
+  return this->lu;
+}
+
+const std::vector<size_t> &LU::pivots() const {
+  return this->pivot;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "matrix.h"
+
+namespace task {
+
+const size_t LU_BLOCK = 64;
+
+// Partially pivoted factorization P * A = L * U of a square matrix.
+// L (unit diagonal, not stored) and U share one packed Matrix.
+class LU {
+
+ public:
+
+  explicit LU(const Matrix &a);
+  // Keeps the factors in resource, e.g. scratch_resource() for a short-lived factorization.
+  LU(const Matrix &a, std::pmr::memory_resource *resource);
+
+  double det() const;
+  bool is_singular() const;
+  // A^-1 B for every column of B (or for b); throws SingularMatrixException on a zero pivot.
+  Matrix solve(const Matrix &b) const;
+  std::vector<double> solve(const std::vector<double> &b) const;
+  Matrix inverse() const;
+  size_t size() const;
+
+  const Matrix &factors() const;
+  const std::vector<size_t> &pivots() const;
+
+ private:
+
+  void factorize();
+
+  Matrix lu;
+  std::vector<size_t> pivot;
+  int sign;
+
+};
+
+}  // namespace task
@@ -1,5 +1,17 @@
 #include "matrix.h"
+#include "cholesky.h"
+#include "gemm.h"
+#include "kernels.h"
+#include "lu.h"
+#include "qr.h"
+#include "thread_pool.h"
 #include "vector"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <new>
+#include <string>
 
 using namespace task;
 
@@ -21,207 +33,444 @@ size_t Matrix::n_cols() const {
   return this->cols;
 }
 
+size_t Matrix::leading_dim() const {
+  return this->stride;
+}
+
+double *Matrix::data() {
+  return this->array;
+}
+
+const double *Matrix::data() const {
+  return this->array;
+}
+
+size_t Matrix::aligned_stride(size_t cols) {
+  const size_t per_line = MATRIX_ALIGNMENT / sizeof(double);
+  return (cols + per_line - 1) / per_line * per_line;
+}
+
+double *Matrix::allocate(size_t count) const {
+  if (count == 0) {
+    return nullptr;
+  }
+  auto *buffer = static_cast<double *>(this->memory->allocate(count * sizeof(double),
+                                                              MATRIX_ALIGNMENT));
+  std::memset(buffer, 0, count * sizeof(double));
+  return buffer;
+}
+
+void Matrix::deallocate(double *buffer, size_t count) const {
+  if (buffer != nullptr) {
+    this->memory->deallocate(buffer, count * sizeof(double), MATRIX_ALIGNMENT);
+  }
+}
+
+std::pmr::memory_resource *Matrix::resource() const {
+  return this->memory;
+}
+
 Matrix::Matrix() {
+  this->memory = default_matrix_resource();
   this->rows = 1;
   this->cols = 1;
-  this->array = new double *[1];
-  *(this->array + 0) = new double{1};
+  this->stride = aligned_stride(1);
+  this->allocated = this->rows * this->stride;
+  this->array = allocate(this->allocated);
+  *this->array = 1;
 }
 
-Matrix::Matrix(size_t row, size_t col) {
+Matrix::Matrix(size_t row, size_t col) : Matrix(row, col, default_matrix_resource()) {}
+
+Matrix::Matrix(size_t row, size_t col, std::pmr::memory_resource *resource) {
+  this->memory = resource;
   this->rows = row;
   this->cols = col;
-  this->array = new double *[this->rows];
-  for (size_t i = 0; i < this->rows; ++i) {
-    *(this->array + i) = new double[this->cols];
-    for (size_t j = 0; j < this->cols; ++j) {
-      if (i == j) {
-        *(*(this->array + i) + j) = 1;
-      } else {
-        *(*(this->array + i) + j) = 0;
-      }
-    }
+  this->stride = aligned_stride(col);
+  this->allocated = this->rows * this->stride;
+  this->array = allocate(this->allocated);
+  for (size_t i = 0; i < this->rows && i < this->cols; ++i) {
+    *(this->array + i * this->stride + i) = 1;
   }
 }
 
+// Fresh buffers come zero-filled from allocate(), so only the diagonal is skipped.
+Matrix Matrix::zero(size_t rows, size_t cols, std::pmr::memory_resource *resource) {
+  Matrix result(0, 0, resource);
+  result.reshape(rows, cols);
+  return result;
+}
+
 Matrix::~Matrix() {
-  for (size_t i = 0; i < this->rows; ++i) {
-    delete[] *(this->array + i);
-  }
-  delete[] this->array;
+  deallocate(this->array, this->allocated);
 }
 
-Matrix::Matrix(const Matrix &copy) {
+Matrix::Matrix(const Matrix &copy) : Matrix(copy, default_matrix_resource()) {}
+
+Matrix::Matrix(const Matrix &copy, std::pmr::memory_resource *resource) {
+  this->memory = resource;
   this->rows = copy.rows;
   this->cols = copy.cols;
-  this->array = new double *[this->rows];
-  for (size_t i = 0; i < this->rows; ++i) {
-    *(this->array + i) = new double[this->cols];
-    for (size_t j = 0; j < this->cols; ++j) {
-      *(*(this->array + i) + j) = *(*(copy.array + i) + j);
-    }
+  this->stride = copy.stride;
+  this->allocated = this->rows * this->stride;
+  this->array = allocate(this->allocated);
+  if (this->array != nullptr) {
+    std::memcpy(this->array, copy.array, this->rows * this->stride * sizeof(double));
+  }
+}
+
+Matrix::Matrix(Matrix &&other) noexcept
+    : rows(other.rows), cols(other.cols), stride(other.stride), allocated(other.allocated),
+      array(other.array), memory(other.memory) {
+  other.rows = 0;
+  other.cols = 0;
+  other.stride = 0;
+  other.allocated = 0;
+  other.array = nullptr;
+}
+
+// The buffer is only taken over from a matrix whose resource can free it; otherwise the
+// elements are copied into this matrix's own resource.
+Matrix &Matrix::operator=(Matrix &&other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (*this->memory != *other.memory) {
+    return *this = static_cast<const Matrix &>(other);
   }
+  Matrix tmp_matrix(std::move(other));
+  swap(tmp_matrix);
+  return *this;
+}
+
+void Matrix::swap(Matrix &other) noexcept {
+  std::swap(this->rows, other.rows);
+  std::swap(this->cols, other.cols);
+  std::swap(this->stride, other.stride);
+  std::swap(this->allocated, other.allocated);
+  std::swap(this->array, other.array);
+  std::swap(this->memory, other.memory);
 }
 
 Matrix &Matrix::operator=(const Matrix &a) {
   if (this == &a) {
     return *this;
   }
-  for (size_t i = 0; i < this->rows; ++i) {
-    delete[] *(this->array + i);
-  }
-  delete[] this->array;
-  this->rows = a.rows;
-  this->cols = a.cols;
-  this->array = new double *[this->rows];
-  for (size_t i = 0; i < this->rows; ++i) {
-    *(this->array + i) = new double[this->cols];
-    for (size_t j = 0; j < this->cols; ++j) {
-      *(*(this->array + i) + j) = *(*(a.array + i) + j);
-    }
+  reshape(a.rows, a.cols);
+  if (this->array != nullptr) {
+    std::memcpy(this->array, a.array, this->rows * this->stride * sizeof(double));
   }
   return *this;
 }
 
+// Resizes for a full overwrite: the buffer is kept whenever it is large enough, and its old
+// contents are left for the caller to replace.
+void Matrix::reshape(size_t new_rows, size_t new_cols) {
+  size_t new_stride = aligned_stride(new_cols);
+  if (new_rows * new_stride > this->allocated) {
+    deallocate(this->array, this->allocated);
+    this->array = allocate(new_rows * new_stride);
+    this->allocated = new_rows * new_stride;
+  }
+  this->rows = new_rows;
+  this->cols = new_cols;
+  this->stride = new_stride;
+}
+
+// Moves the current rows into a fresh buffer of count elements; the layout does not change.
+void Matrix::reallocate(size_t count) {
+  double *buffer = allocate(count);
+  if (buffer != nullptr && this->array != nullptr) {
+    std::memcpy(buffer, this->array, this->rows * this->stride * sizeof(double));
+  }
+  deallocate(this->array, this->allocated);
+  this->array = buffer;
+  this->allocated = count;
+}
+
 double &Matrix::get(size_t row, size_t col) {
   if (!check_bounds(this->rows, this->cols, row, col)) {
     throw OutOfBoundsException();
   }
-  return (*this)[row][col];
+  return *(this->array + row * this->stride + col);
 }
 
 const double &Matrix::get(size_t row, size_t col) const {
   if (!check_bounds(this->rows, this->cols, row, col)) {
     throw OutOfBoundsException();
   }
-  auto *tmp = (*this)[row];
-  auto val = new double[1]{*(tmp + col)};
-  delete[] tmp;
-  return *val;
+  return *(this->array + row * this->stride + col);
 }
 
 void Matrix::set(size_t row, size_t col, const double &value) {
   if (!check_bounds(this->rows, this->cols, row, col)) {
     throw OutOfBoundsException();
   }
-  (*this)[row][col] = value;
+  *(this->array + row * this->stride + col) = value;
+}
+
+namespace {
+
+// Calls copy(from, to, length) for the runs of the first count elements (in row-major order)
+// that are contiguous both in a cols-wide layout with the given stride and in a new_cols-wide
+// one with new_stride, from the first run to the last or the other way round.
+template <class F>
+void for_each_run(bool ascending, size_t count, size_t cols, size_t stride, size_t new_cols,
+                  size_t new_stride, F copy) {
+  if (ascending) {
+    for (size_t k = 0; k < count;) {
+      size_t j = k % cols;
+      size_t new_j = k % new_cols;
+      size_t length = std::min({cols - j, new_cols - new_j, count - k});
+      copy(k / cols * stride + j, k / new_cols * new_stride + new_j, length);
+      k += length;
+    }
+    return;
+  }
+  for (size_t k = count; k > 0;) {
+    size_t j = (k - 1) % cols;
+    size_t new_j = (k - 1) % new_cols;
+    size_t length = std::min({j + 1, new_j + 1, k});
+    copy((k - 1) / cols * stride + j + 1 - length,
+         (k - 1) / new_cols * new_stride + new_j + 1 - length, length);
+    k -= length;
+  }
 }
 
-void Matrix::resize(size_t new_rows, size_t new_cols) {
-  auto **new_array = new double *[new_rows];
-  size_t cur_i;
-  size_t cur_j;
-  for (size_t i = 0; i < new_rows; ++i) {
-    *(new_array + i) = new double[new_cols];
-    for (size_t j = 0; j < new_cols; ++j) {
-      cur_i = (i * new_cols + j) / this->cols;
-      cur_j = (i * new_cols + j) % this->cols;
-      if (cur_i < this->rows) {
-        *(*(new_array + i) + j) = *(*(this->array + cur_i) + cur_j);
-      } else {
-        *(*(new_array + i) + j) = 0;
-      }
-    }
+}  // namespace
+
+// Changes the row width keeping the element order. The runs are moved in place when the
+// buffer is large enough and every run moves the same way (all towards the front or all
+// towards the back), otherwise they are copied into a new buffer.
+void Matrix::remap(size_t new_rows, size_t new_cols) {
+  size_t new_stride = aligned_stride(new_cols);
+  size_t needed = new_rows * new_stride;
+  size_t count = std::min(this->rows * this->cols, new_rows * new_cols);
+  bool forward = true;
+  bool backward = true;
+  for_each_run(true, count, this->cols, this->stride, new_cols, new_stride,
+               [&](size_t from, size_t to, size_t) {
+                 forward = forward && to <= from;
+                 backward = backward && to >= from;
+               });
+  if (needed <= this->allocated && (forward || backward)) {
+    double *buffer = this->array;
+    for_each_run(forward, count, this->cols, this->stride, new_cols, new_stride,
+                 [buffer](size_t from, size_t to, size_t length) {
+                   std::memmove(buffer + to, buffer + from, length * sizeof(double));
+                 });
+  } else {
+    size_t capacity = needed > this->allocated ? std::max(needed, 2 * this->allocated) : this->allocated;
+    double *buffer = allocate(capacity);
+    const double *source = this->array;
+    for_each_run(true, count, this->cols, this->stride, new_cols, new_stride,
+                 [buffer, source](size_t from, size_t to, size_t length) {
+                   std::memcpy(buffer + to, source + from, length * sizeof(double));
+                 });
+    deallocate(this->array, this->allocated);
+    this->array = buffer;
+    this->allocated = capacity;
   }
-  for (size_t i = 0; i < this->rows; ++i) {
-    delete[] *(this->array + i);
+  for (size_t k = count; k < new_rows * new_cols;) {
+    size_t j = k % new_cols;
+    size_t length = std::min(new_cols - j, new_rows * new_cols - k);
+    std::memset(this->array + k / new_cols * new_stride + j, 0, length * sizeof(double));
+    k += length;
   }
-  delete[] this->array;
-  this->array = new_array;
   this->rows = new_rows;
   this->cols = new_cols;
+  this->stride = new_stride;
 }
 
-double *Matrix::operator[](size_t row) {
-  return *(this->array + row);
+void Matrix::resize(size_t new_rows, size_t new_cols) {
+  if (new_cols != this->cols) {
+    remap(new_rows, new_cols);
+    return;
+  }
+  // Same width: rows are appended or dropped at the end and the data stays where it is.
+  size_t needed = new_rows * this->stride;
+  if (needed > this->allocated) {
+    reallocate(std::max(needed, 2 * this->allocated));
+  }
+  if (new_rows > this->rows && this->array != nullptr) {
+    std::memset(this->array + this->rows * this->stride, 0,
+                (new_rows - this->rows) * this->stride * sizeof(double));
+  }
+  this->rows = new_rows;
 }
 
-double *Matrix::operator[](size_t row) const {
-  auto *row_copy = new double[this->cols];
-  for (size_t i = 0; i < this->cols; ++i) {
-    *(row_copy + i) = *(*(this->array + row) + i);
+void Matrix::reserve(size_t rows, size_t cols) {
+  size_t needed = std::max(rows * aligned_stride(cols), this->rows * this->stride);
+  if (needed > this->allocated) {
+    reallocate(needed);
   }
-  return row_copy;
+}
+
+void Matrix::shrink_to_fit() {
+  if (this->rows * this->stride < this->allocated) {
+    reallocate(this->rows * this->stride);
+  }
+}
+
+size_t Matrix::capacity() const {
+  return this->allocated;
+}
+
+double *Matrix::operator[](size_t row) {
+  return this->array + row * this->stride;
+}
+
+const double *Matrix::operator[](size_t row) const {
+  return this->array + row * this->stride;
+}
+
+RowView Matrix::row(size_t row) {
+  return view().row(row);
+}
+
+ConstRowView Matrix::row(size_t row) const {
+  return view().row(row);
+}
+
+ColView Matrix::col(size_t col) {
+  return view().col(col);
+}
+
+ConstColView Matrix::col(size_t col) const {
+  return view().col(col);
+}
+
+SubMatrixView Matrix::block(size_t row, size_t col, size_t n_rows, size_t n_cols) {
+  return view().block(row, col, n_rows, n_cols);
+}
+
+ConstSubMatrixView Matrix::block(size_t row, size_t col, size_t n_rows, size_t n_cols) const {
+  return view().block(row, col, n_rows, n_cols);
+}
+
+SubMatrixView Matrix::view() {
+  return SubMatrixView(this->array, this->rows, this->cols, this->stride);
+}
+
+ConstSubMatrixView Matrix::view() const {
+  return ConstSubMatrixView(this->array, this->rows, this->cols, this->stride);
+}
+
+TransposedView Matrix::transposed_view() const {
+  return TransposedView(this->array, this->rows, this->cols, this->stride);
 }
 
 Matrix &Matrix::operator+=(const Matrix &a) {
   if (!check_size(this->rows, this->cols, a.rows, a.cols)) {
     throw SizeMismatchException();
   }
-  for (size_t i = 0; i < this->rows; ++i) {
-    for (size_t j = 0; j < this->cols; ++j) {
-      *(*(this->array + i) + j) += *(*(a.array + i) + j);
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      kernels::add(this->array + i * this->stride, a.array + i * a.stride, this->cols);
     }
-  }
+  });
   return *this;
 }
 
 Matrix &Matrix::operator-=(const Matrix &a) {
-  return *this += -a;
+  if (!check_size(this->rows, this->cols, a.rows, a.cols)) {
+    throw SizeMismatchException();
+  }
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      kernels::sub(this->array + i * this->stride, a.array + i * a.stride, this->cols);
+    }
+  });
+  return *this;
 }
 
-Matrix &Matrix::operator*=(const Matrix &a) {
-  if (this->cols != a.rows) {
+Matrix &Matrix::axpy(const double &alpha, const Matrix &a) {
+  if (!check_size(this->rows, this->cols, a.rows, a.cols)) {
     throw SizeMismatchException();
   }
-  for (size_t i = 0; i < this->rows; ++i) {
-    auto *new_row = new double[a.cols];
-    for (size_t j = 0; j < a.cols; ++j) {
-      double value = 0;
-      for (size_t k = 0; k < this->cols; ++k) {
-        value += this->get(i, k) * a.get(k, j);
-      }
-      *(new_row + j) = value;
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      kernels::axpy(this->array + i * this->stride, alpha, a.array + i * a.stride, this->cols);
     }
-    delete[] *(this->array + i);
-    *(this->array + i) = new_row;
-  }
-  this->cols = a.cols;
+  });
+  return *this;
+}
+
+Matrix &Matrix::operator*=(const Matrix &a) {
+  Matrix product = *this * a;
+  swap(product);
   return *this;
 }
 
 Matrix &Matrix::operator*=(const double &number) {
-  for (size_t i = 0; i < this->rows; ++i) {
-    for (size_t j = 0; j < this->cols; ++j) {
-      *(*(this->array + i) + j) *= number;
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      kernels::scale(this->array + i * this->stride, number, this->cols);
     }
-  }
+  });
   return *this;
 }
 
-Matrix Matrix::operator+(const Matrix &a) const {
-  Matrix tmp_matrix = *this;
-  return tmp_matrix += a;
+Matrix Matrix::operator*(const Matrix &a) const & {
+  return multiply(dense_operand(*this), dense_operand(a), this->memory);
 }
 
-Matrix Matrix::operator-(const Matrix &a) const {
-  Matrix tmp_matrix = *this;
-  return tmp_matrix -= a;
+Matrix Matrix::operator*(const Matrix &a) && {
+  *this *= a;
+  return std::move(*this);
 }
 
-Matrix Matrix::operator*(const Matrix &a) const {
-  Matrix tmp_matrix = *this;
-  return tmp_matrix *= a;
+Matrix task::multiply(const DenseOperand &left, const DenseOperand &right,
+                      std::pmr::memory_resource *resource) {
+  if (left.cols != right.rows) {
+    throw SizeMismatchException();
+  }
+  Matrix tmp_matrix(0, 0, resource);
+  tmp_matrix.reshape(left.rows, right.cols);
+  gemm(left.transposed ? GemmOp::Transpose : GemmOp::None,
+       right.transposed ? GemmOp::Transpose : GemmOp::None,
+       left.rows, right.cols, left.cols, 1.0, left.data, left.ld, right.data, right.ld,
+       tmp_matrix.array, tmp_matrix.stride);
+  return tmp_matrix;
 }
 
-Matrix Matrix::operator*(const double &a) const {
-  Matrix tmp_matrix = *this;
-  return tmp_matrix *= a;
+Matrix task::operator+(Matrix &&left, Matrix &&right) {
+  left += right;
+  return std::move(left);
 }
 
-Matrix Matrix::operator-() const {
-  Matrix tmp_matrix = *this;
-  tmp_matrix *= -1.0;
-  return tmp_matrix;
+Matrix task::operator-(Matrix &&left, Matrix &&right) {
+  left -= right;
+  return std::move(left);
+}
+
+Matrix task::operator-(Matrix &&source) {
+  size_t size = source.n_rows() * source.n_cols();
+  parallel_for(0, source.n_rows(), size, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      double *row = source[i];
+      kernels::negate(row, row, source.n_cols());
+    }
+  });
+  return std::move(source);
+}
+
+Matrix task::operator*(Matrix &&source, const double &factor) {
+  source *= factor;
+  return std::move(source);
+}
+
+Matrix task::operator*(const double &factor, Matrix &&source) {
+  source *= factor;
+  return std::move(source);
 }
 
 Matrix Matrix::operator+() const {
-  Matrix tmp_matrix = *this;
-  return tmp_matrix;
+  return Matrix(*this, this->memory);
 }
 
 Matrix Matrix::get_minor(size_t row, size_t col) const {
-  Matrix tmp_matrix(this->rows - 1, this->cols - 1);
+  Matrix tmp_matrix(this->rows - 1, this->cols - 1, this->memory);
   size_t new_i;
   size_t new_j;
   for (size_t i = 0; i < this->rows; ++i) {
@@ -255,41 +504,62 @@ double Matrix::det() const {
   } else if (this->rows == 2) {
     return this->get(0, 0) * this->get(1, 1) - this->get(1, 0) * this->get(0, 1);
   } else {
-    double d = 0;
-    for (size_t i = 0; i < this->cols; ++i) {
-      Matrix tmp_matrix = get_minor(0, i);
-      if (i % 2 == 0) {
-        d += this->get(0, i) * tmp_matrix.det();
-      } else {
-        d -= this->get(0, i) * tmp_matrix.det();
-      }
-    }
-    return d;
+    return LU(*this, scratch_resource()).det();
   }
 }
 
+LU Matrix::lu() const {
+  return LU(*this);
+}
+
+Cholesky Matrix::cholesky() const {
+  return Cholesky(*this);
+}
+
+QR Matrix::qr() const {
+  return QR(*this);
+}
+
+Matrix Matrix::solve(const Matrix &b) const {
+  return LU(*this, scratch_resource()).solve(b);
+}
+
+std::vector<double> Matrix::solve(const std::vector<double> &b) const {
+  return LU(*this, scratch_resource()).solve(b);
+}
+
+Matrix Matrix::inverse() const {
+  return LU(*this, scratch_resource()).inverse();
+}
+
 void Matrix::transpose() {
-  auto new_array = new double *[this->cols];
-  for (size_t j = 0; j < this->cols; ++j) {
-    *(new_array + j) = new double[this->rows];
-    for (size_t i = 0; i < this->rows; ++i) {
-      *(*(new_array + j) + i) = *(*(this->array + i) + j);
-    }
-  }
-  for (size_t i = 0; i < this->rows; ++i) {
-    delete[] *(this->array + i);
+  if (this->rows == this->cols) {
+    size_t tiles = (this->rows + kernels::TRANSPOSE_TILE - 1) / kernels::TRANSPOSE_TILE;
+    parallel_for(0, tiles, this->rows * this->cols, [&](size_t first, size_t last) {
+      kernels::transpose_square(this->array, this->stride, this->rows,
+                                first * kernels::TRANSPOSE_TILE,
+                                std::min(this->rows, last * kernels::TRANSPOSE_TILE));
+    });
+    return;
   }
-  delete[] this->array;
-  this->array = new_array;
-  size_t tmp = this->rows;
-  this->rows = this->cols;
-  this->cols = tmp;
+  Matrix tmp_matrix = transposed();
+  swap(tmp_matrix);
+}
+
+Matrix Matrix::transposed() const & {
+  Matrix tmp_matrix(0, 0, this->memory);
+  tmp_matrix.reshape(this->cols, this->rows);
+  parallel_for(0, this->cols, this->rows * this->cols, [&](size_t first, size_t last) {
+    kernels::transpose(this->array + first, this->stride,
+                       tmp_matrix.array + first * tmp_matrix.stride, tmp_matrix.stride,
+                       this->rows, last - first);
+  });
+  return tmp_matrix;
 }
 
-Matrix Matrix::transposed() const {
-  Matrix tmp_matrix = *this;
-  tmp_matrix.transpose();
-  return tmp_matrix;
+Matrix Matrix::transposed() && {
+  transpose();
+  return std::move(*this);
 }
 
 double Matrix::trace() const {
@@ -304,30 +574,92 @@ double Matrix::trace() const {
 }
 
 std::vector<double> Matrix::getRow(size_t row) {
-  std::vector<double> row_vector(*(this->array + row), *(this->array + row) + this->cols);
-  return row_vector;
+  return this->row(row).to_vector();
 }
 
 std::vector<double> Matrix::getColumn(size_t column) {
-  std::vector<double> col_vector(this->rows);
-  for (size_t i = 0; i < this->rows; ++i) {
-    col_vector.push_back((*this).get(i, column));
+  return this->col(column).to_vector();
+}
+
+namespace {
+
+bool is_space(int c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Copies the next rows * cols whitespace-separated tokens into `text`, each followed by a single
+// space, and records where every row starts. The stream is left right after the last token.
+bool read_tokens(std::istream &input, size_t rows, size_t cols, std::string &text,
+                 std::vector<size_t> &row_starts) {
+  using traits = std::istream::traits_type;
+  std::streambuf *buffer = input.rdbuf();
+  int c = buffer->sgetc();
+  for (size_t i = 0; i < rows; ++i) {
+    row_starts.push_back(text.size());
+    for (size_t j = 0; j < cols; ++j) {
+      while (c != traits::eof() && is_space(c)) {
+        c = buffer->snextc();
+      }
+      if (c == traits::eof()) {
+        return false;
+      }
+      while (c != traits::eof() && !is_space(c)) {
+        text.push_back(static_cast<char>(c));
+        c = buffer->snextc();
+      }
+      text.push_back(' ');
+    }
+  }
+  if (c == traits::eof()) {
+    input.setstate(std::ios_base::eofbit);
+  }
+  return true;
+}
+
+bool parse_row(const char *first, const char *last, double *row, size_t cols) {
+  for (size_t j = 0; j < cols; ++j) {
+    if (*first == '+') {
+      ++first;
+    }
+    std::from_chars_result result = std::from_chars(first, last, *(row + j));
+    if (result.ec != std::errc() || result.ptr == last || *result.ptr != ' ') {
+      return false;
+    }
+    first = result.ptr + 1;
   }
-  return col_vector;
+  return true;
 }
 
+}  // namespace
+
 std::istream &task::operator>>(std::istream &input, Matrix &matrix) {
   size_t rows;
   size_t cols;
-  double value;
-  input >> rows >> cols;
-  matrix.resize(rows, cols);
-  for (size_t i = 0; i < rows; ++i) {
-    for (size_t j = 0; j < cols; ++j) {
-      input >> value;
-      matrix.set(i, j, value);
+  if (!(input >> rows >> cols)) {
+    return input;
+  }
+  std::string text;
+  std::vector<size_t> row_starts;
+  if (!read_tokens(input, rows, cols, text, row_starts)) {
+    input.setstate(std::ios_base::failbit | std::ios_base::eofbit);
+    return input;
+  }
+  // Parsed aside, so a malformed input leaves the target untouched.
+  Matrix parsed(rows, cols, matrix.memory);
+  std::atomic<bool> failed(false);
+  const char *last = text.data() + text.size();
+  parallel_for(0, rows, text.size(), [&](size_t first, size_t end) {
+    for (size_t i = first; i < end; ++i) {
+      if (!parse_row(text.data() + row_starts[i], last, parsed.array + i * parsed.stride, cols)) {
+        failed = true;
+      }
     }
+  });
+  if (failed) {
+    input.setstate(std::ios_base::failbit);
+    return input;
   }
+  matrix.swap(parsed);
   return input;
 }
 
@@ -349,13 +681,9 @@ bool Matrix::operator==(const Matrix &a) const {
   if (!check_size(this->rows, this->cols, a.rows, a.cols)) {
     return false;
   }
-  double diff;
   for (size_t i = 0; i < this->rows; ++i) {
-    for (size_t j = 0; j < this->cols; ++j) {
-      diff = this->get(i, j) - a.get(i, j);
-      if (diff > EPS || -diff > EPS) {
-        return false;
-      }
+    if (!kernels::equal(this->array + i * this->stride, a.array + i * a.stride, this->cols, EPS)) {
+      return false;
     }
   }
   return true;
@@ -364,7 +692,3 @@ bool Matrix::operator==(const Matrix &a) const {
 bool Matrix::operator!=(const Matrix &a) const {
   return !(*this == a);
 }
-
-Matrix task::operator*(const double &a, const Matrix &b) {
-  return b * a;
-}
\ No newline at end of file
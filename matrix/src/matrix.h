@@ -2,48 +2,100 @@
 
 #include <vector>
 #include <iostream>
+#include <utility>
+#include "aligned_memory.h"
+#include "exceptions.h"
+#include "matrix_expr.h"
+#include "matrix_view.h"
+#include "thread_pool.h"
 
 namespace task {
 
-const double EPS = 1e-6;
+constexpr double EPS = 1e-6;
 
-class OutOfBoundsException : public std::exception {};
-class SizeMismatchException : public std::exception {};
+class LU;
+class Cholesky;
+class QR;
 
-class Matrix {
+// Storage comes from a std::pmr::memory_resource, default_matrix_resource() unless one is
+// given, and follows the std::pmr container rules: copies use the default resource unless
+// told otherwise, assignment keeps the target's resource, moves and swap take the buffer
+// together with its resource. Every buffer is MATRIX_ALIGNMENT-aligned.
+// Expressions may read the matrix they are assigned to: one reading it element for element is
+// evaluated in place, any other overlap (a transposed or shifted view) through a temporary.
+class Matrix : public MatrixExpr<Matrix> {
 
  public:
 
   Matrix();
   Matrix(size_t rows, size_t cols);
+  Matrix(size_t rows, size_t cols, std::pmr::memory_resource *resource);
+  // The constructors build an identity matrix; this builds a rows x cols matrix of zeros.
+  static Matrix zero(size_t rows, size_t cols,
+                     std::pmr::memory_resource *resource = default_matrix_resource());
   Matrix(const Matrix &copy);
+  Matrix(const Matrix &copy, std::pmr::memory_resource *resource);
+  Matrix(Matrix &&other) noexcept;
   Matrix &operator=(const Matrix &a);
+  Matrix &operator=(Matrix &&other);
   ~Matrix();
+  void swap(Matrix &other) noexcept;
+  std::pmr::memory_resource *resource() const;
+
+  template <class E, class = enable_if_matrix_expr<E>>
+  Matrix(const E &expr);
+  template <class E, class = enable_if_matrix_expr<E>>
+  Matrix &operator=(const E &expr);
 
   double &get(size_t row, size_t col);
   const double &get(size_t row, size_t col) const;
   void set(size_t row, size_t col, const double &value);
+  // Keeps the row-major order of the elements and zero-fills new ones. Storage is only
+  // reallocated when the new shape exceeds capacity(); row growth is amortized O(1) per row.
   void resize(size_t new_rows, size_t new_cols);
+  // Makes room for a rows x cols shape without changing the current one.
+  void reserve(size_t rows, size_t cols);
+  void shrink_to_fit();
+  size_t capacity() const;
 
   double *operator[](size_t row);
-  double *operator[](size_t row) const;
+  const double *operator[](size_t row) const;
+
+  RowView row(size_t row);
+  ConstRowView row(size_t row) const;
+  ColView col(size_t col);
+  ConstColView col(size_t col) const;
+  SubMatrixView block(size_t row, size_t col, size_t n_rows, size_t n_cols);
+  ConstSubMatrixView block(size_t row, size_t col, size_t n_rows, size_t n_cols) const;
+  SubMatrixView view();
+  ConstSubMatrixView view() const;
+  TransposedView transposed_view() const;
 
   Matrix &operator+=(const Matrix &a);
   Matrix &operator-=(const Matrix &a);
   Matrix &operator*=(const Matrix &a);
   Matrix &operator*=(const double &number);
+  Matrix &axpy(const double &alpha, const Matrix &a);
 
-  Matrix operator+(const Matrix &a) const;
-  Matrix operator-(const Matrix &a) const;
-  Matrix operator*(const Matrix &a) const;
-  Matrix operator*(const double &a) const;
+  template <class E, class = enable_if_matrix_expr<E>>
+  Matrix &operator+=(const E &expr);
+  template <class E, class = enable_if_matrix_expr<E>>
+  Matrix &operator-=(const E &expr);
 
-  Matrix operator-() const;
+  Matrix operator*(const Matrix &a) const &;
+  Matrix operator*(const Matrix &a) &&;
   Matrix operator+() const;
 
   double det() const;
+  LU lu() const;
+  Cholesky cholesky() const;
+  QR qr() const;
+  Matrix solve(const Matrix &b) const;
+  std::vector<double> solve(const std::vector<double> &b) const;
+  Matrix inverse() const;
   void transpose();
-  Matrix transposed() const;
+  Matrix transposed() const &;
+  Matrix transposed() &&;
   double trace() const;
 
   std::vector<double> getRow(size_t row);
@@ -55,16 +107,220 @@ class Matrix {
   Matrix get_minor(size_t row, size_t col) const;
   size_t n_rows() const;
   size_t n_cols() const;
+  size_t leading_dim() const;
+  double *data();
+  const double *data() const;
+
+  double at(size_t row, size_t col) const {
+    return *(this->array + row * this->stride + col);
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return aliased({this->array, this->rows, this->cols, this->stride, false}, target);
+  }
+
+  // Leading dimension used for a row of `cols` elements: rows start on MATRIX_ALIGNMENT bytes.
+  static size_t aligned_stride(size_t cols);
 
  private:
 
+  double *allocate(size_t count) const;
+  void deallocate(double *buffer, size_t count) const;
+
+  void reallocate(size_t count);
+  void remap(size_t new_rows, size_t new_cols);
+
+  void reshape(size_t new_rows, size_t new_cols);
+  template <class E>
+  void assign(const E &expr);
+  template <class E, class Op>
+  void update(const E &expr);
+
+  friend Matrix multiply(const DenseOperand &left, const DenseOperand &right,
+                         std::pmr::memory_resource *resource);
+  friend std::istream &operator>>(std::istream &input, Matrix &matrix);
+
   size_t rows;
   size_t cols;
-  double **array;
+  size_t stride;
+  size_t allocated;
+  double *array;
+  std::pmr::memory_resource *memory;
 
 };
 
-Matrix operator*(const double &a, const Matrix &b);
+template <class E, class>
+Matrix::Matrix(const E &expr)
+    : rows(0), cols(0), stride(0), allocated(0), array(nullptr),
+      memory(default_matrix_resource()) {
+  assign(expr);
+}
+
+template <class E, class>
+Matrix &Matrix::operator=(const E &expr) {
+  assign(expr);
+  return *this;
+}
+
+template <class E>
+void Matrix::assign(const E &expr) {
+  if (expr.aliases({this->array, this->rows, this->cols, this->stride, false})) {
+    Matrix result(expr.n_rows(), expr.n_cols(), this->memory);
+    result.assign(expr);
+    swap(result);
+    return;
+  }
+  reshape(expr.n_rows(), expr.n_cols());
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      double *row = this->array + i * this->stride;
+#pragma GCC ivdep
+      for (size_t j = 0; j < this->cols; ++j) {
+        *(row + j) = expr.at(i, j);
+      }
+    }
+  });
+}
+
+template <class E, class Op>
+void Matrix::update(const E &expr) {
+  if (this->rows != expr.n_rows() || this->cols != expr.n_cols()) {
+    throw SizeMismatchException();
+  }
+  if (expr.aliases({this->array, this->rows, this->cols, this->stride, false})) {
+    update<Matrix, Op>(Matrix(expr));
+    return;
+  }
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      double *row = this->array + i * this->stride;
+#pragma GCC ivdep
+      for (size_t j = 0; j < this->cols; ++j) {
+        *(row + j) = Op::apply(*(row + j), expr.at(i, j));
+      }
+    }
+  });
+}
+
+template <class E, class>
+Matrix &Matrix::operator+=(const E &expr) {
+  update<E, ExprPlus>(expr);
+  return *this;
+}
+
+template <class E, class>
+Matrix &Matrix::operator-=(const E &expr) {
+  update<E, ExprMinus>(expr);
+  return *this;
+}
+
+template <class L, class R, class = enable_if_matrix_expr<L, R>>
+MatrixBinaryExpr<L, R, ExprPlus> operator+(const L &left, const R &right) {
+  return MatrixBinaryExpr<L, R, ExprPlus>(left, right);
+}
+
+template <class L, class R, class = enable_if_matrix_expr<L, R>>
+MatrixBinaryExpr<L, R, ExprMinus> operator-(const L &left, const R &right) {
+  return MatrixBinaryExpr<L, R, ExprMinus>(left, right);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+MatrixScaledExpr<E> operator*(const E &source, const double &factor) {
+  return MatrixScaledExpr<E>(source, factor);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+MatrixScaledExpr<E> operator*(const double &factor, const E &source) {
+  return MatrixScaledExpr<E>(source, factor);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+MatrixNegatedExpr<E> operator-(const E &source) {
+  return MatrixNegatedExpr<E>(source);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+E operator+(const E &source) {
+  return source;
+}
+
+template <>
+struct has_dense_operand<Matrix> : std::true_type {};
+
+inline DenseOperand dense_operand(const Matrix &matrix) {
+  return {matrix.data(), matrix.n_rows(), matrix.n_cols(), matrix.leading_dim(), false};
+}
+
+// op(left) * op(right) through gemm; throws SizeMismatchException on inner dimension mismatch.
+Matrix multiply(const DenseOperand &left, const DenseOperand &right,
+                std::pmr::memory_resource *resource = default_matrix_resource());
+
+// Matrices and views are passed to gemm as they are; other expressions are evaluated first.
+template <class E>
+std::conditional_t<has_dense_operand<E>::value, const E &, Matrix> materialize(const E &expr) {
+  return expr;
+}
+
+// Matrix products are never lazy: operands are multiplied through gemm right away.
+template <class L, class R, class = enable_if_matrix_expr<L, R>>
+Matrix operator*(const L &left, const R &right) {
+  const auto &left_dense = materialize(left);
+  const auto &right_dense = materialize(right);
+  return multiply(dense_operand(left_dense), dense_operand(right_dense));
+}
+
+// Operators taking a Matrix temporary evaluate into its buffer instead of allocating.
+template <class E, class = enable_if_matrix_expr<E>>
+Matrix operator+(Matrix &&left, const E &right) {
+  left += right;
+  return std::move(left);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+Matrix operator+(const E &left, Matrix &&right) {
+  right += left;
+  return std::move(right);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+Matrix operator-(Matrix &&left, const E &right) {
+  left -= right;
+  return std::move(left);
+}
+
+template <class E, class = enable_if_matrix_expr<E>>
+Matrix operator-(const E &left, Matrix &&right) {
+  right *= -1.0;
+  right += left;
+  return std::move(right);
+}
+
+Matrix operator+(Matrix &&left, Matrix &&right);
+Matrix operator-(Matrix &&left, Matrix &&right);
+Matrix operator-(Matrix &&source);
+Matrix operator*(Matrix &&source, const double &factor);
+Matrix operator*(const double &factor, Matrix &&source);
+
+template <class L, class R, class = enable_if_matrix_expr<L, R>>
+bool operator==(const L &left, const R &right) {
+  if (left.n_rows() != right.n_rows() || left.n_cols() != right.n_cols()) {
+    return false;
+  }
+  for (size_t i = 0; i < left.n_rows(); ++i) {
+    for (size_t j = 0; j < left.n_cols(); ++j) {
+      double diff = left.at(i, j) - right.at(i, j);
+      if (diff > EPS || -diff > EPS) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <class L, class R, class = enable_if_matrix_expr<L, R>>
+bool operator!=(const L &left, const R &right) {
+  return !(left == right);
+}
 
 std::ostream &operator<<(std::ostream &output, const Matrix &matrix);
 std::istream &operator>>(std::istream &input, Matrix &matrix);
@@ -0,0 +1,329 @@
+#include "matrix_batch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "kernels.h"
+#include "thread_pool.h"
+
+using namespace task;
+
+namespace {
+
+// The tile kernels run on one tile with the lane loop innermost; they are inlined into per-ISA
+// wrappers below so the compiler vectorizes that loop with the widest registers simd_level()
+// allows. Element vector p of a tile starts at p * BATCH_LANES.
+
+#define BATCH_TILE_KERNEL inline __attribute__((always_inline))
+
+BATCH_TILE_KERNEL void multiply_tile(size_t m, size_t n, size_t k, const double *a,
+                                     const double *b, double *c) {
+  const size_t w = BATCH_LANES;
+  for (size_t i = 0; i < m; ++i) {
+    double *c_row = c + i * n * w;
+    std::fill(c_row, c_row + n * w, 0.0);
+    for (size_t p = 0; p < k; ++p) {
+      const double *a_ip = a + (i * k + p) * w;
+      const double *b_row = b + p * n * w;
+      for (size_t j = 0; j < n; ++j) {
+#pragma GCC ivdep
+        for (size_t l = 0; l < w; ++l) {
+          c_row[j * w + l] += a_ip[l] * b_row[j * w + l];
+        }
+      }
+    }
+  }
+}
+
+// Partially pivoted elimination run independently in every lane: pivot choice and row swaps
+// are per-lane selects, so all lanes follow the same instruction stream. work holds a copy
+// of the tile.
+BATCH_TILE_KERNEL void det_tile(size_t n, const double *a, double *work, double *out) {
+  const size_t w = BATCH_LANES;
+  std::copy(a, a + n * n * w, work);
+  double det[BATCH_LANES];
+  double best[BATCH_LANES];
+  double pivot_row[BATCH_LANES];
+  double inverse[BATCH_LANES];
+  std::fill(det, det + w, 1.0);
+  for (size_t k = 0; k < n; ++k) {
+    double *row_k = work + k * n * w;
+#pragma GCC ivdep
+    for (size_t l = 0; l < w; ++l) {
+      best[l] = std::fabs(row_k[k * w + l]);
+      pivot_row[l] = static_cast<double>(k);
+    }
+    for (size_t r = k + 1; r < n; ++r) {
+      const double *entry = work + (r * n + k) * w;
+#pragma GCC ivdep
+      for (size_t l = 0; l < w; ++l) {
+        double value = std::fabs(entry[l]);
+        bool larger = value > best[l];
+        best[l] = larger ? value : best[l];
+        pivot_row[l] = larger ? static_cast<double>(r) : pivot_row[l];
+      }
+    }
+    for (size_t r = k + 1; r < n; ++r) {
+      double *row_r = work + r * n * w;
+      double row = static_cast<double>(r);
+      for (size_t c = k; c < n; ++c) {
+#pragma GCC ivdep
+        for (size_t l = 0; l < w; ++l) {
+          bool swap = pivot_row[l] == row;
+          double x = row_k[c * w + l];
+          double y = row_r[c * w + l];
+          row_k[c * w + l] = swap ? y : x;
+          row_r[c * w + l] = swap ? x : y;
+        }
+      }
+    }
+#pragma GCC ivdep
+    for (size_t l = 0; l < w; ++l) {
+      double pivot = row_k[k * w + l];
+      det[l] *= pivot_row[l] != static_cast<double>(k) ? -pivot : pivot;
+      inverse[l] = 1.0 / (pivot != 0 ? pivot : 1.0);
+    }
+    for (size_t r = k + 1; r < n; ++r) {
+      double *row_r = work + r * n * w;
+      double factor[BATCH_LANES];
+#pragma GCC ivdep
+      for (size_t l = 0; l < w; ++l) {
+        factor[l] = row_r[k * w + l] * inverse[l];
+      }
+      for (size_t c = k + 1; c < n; ++c) {
+#pragma GCC ivdep
+        for (size_t l = 0; l < w; ++l) {
+          row_r[c * w + l] -= factor[l] * row_k[c * w + l];
+        }
+      }
+    }
+  }
+  std::copy(det, det + w, out);
+}
+
+// Tiles [first, last); lda, ldb and ldc are the distances between consecutive tiles.
+using MultiplyKernel = void (*)(size_t first, size_t last, size_t m, size_t n, size_t k,
+                                const double *a, size_t lda, const double *b, size_t ldb,
+                                double *c, size_t ldc);
+using DetKernel = void (*)(size_t first, size_t last, size_t n, const double *a, size_t lda,
+                           double *work, double *out);
+
+#define BATCH_KERNELS(suffix, target_attribute)                                                  \
+  target_attribute void multiply_##suffix(size_t first, size_t last, size_t m, size_t n,        \
+                                          size_t k, const double *a, size_t lda,                \
+                                          const double *b, size_t ldb, double *c, size_t ldc) { \
+    for (size_t tile = first; tile < last; ++tile) {                                            \
+      multiply_tile(m, n, k, a + tile * lda, b + tile * ldb, c + tile * ldc);                   \
+    }                                                                                           \
+  }                                                                                             \
+  target_attribute void det_##suffix(size_t first, size_t last, size_t n, const double *a,      \
+                                     size_t lda, double *work, double *out) {                   \
+    for (size_t tile = first; tile < last; ++tile) {                                            \
+      det_tile(n, a + tile * lda, work, out + tile * BATCH_LANES);                              \
+    }                                                                                           \
+  }
+
+BATCH_KERNELS(avx512, __attribute__((target("avx512f"))))
+BATCH_KERNELS(avx2, __attribute__((target("avx2,fma"))))
+BATCH_KERNELS(generic, )
+
+struct BatchKernels {
+  MultiplyKernel multiply;
+  DetKernel det;
+};
+
+const BatchKernels &batch_kernels() {
+  static const BatchKernels kernels = []() -> BatchKernels {
+    switch (simd_level()) {
+      case SimdLevel::AVX512:
+        return {multiply_avx512, det_avx512};
+      case SimdLevel::AVX2:
+        return {multiply_avx2, det_avx2};
+      default:
+        return {multiply_generic, det_generic};
+    }
+  }();
+  return kernels;
+}
+
+size_t tiles(size_t count) {
+  return (count + BATCH_LANES - 1) / BATCH_LANES;
+}
+
+}  // namespace
+
+MatrixBatch::MatrixBatch(size_t count, size_t rows, size_t cols)
+    : count(count), rows(rows), cols(cols),
+      storage(Matrix::zero(tiles(count), rows * cols * BATCH_LANES)) {}
+
+MatrixBatch::MatrixBatch(const std::vector<Matrix> &matrices)
+    : MatrixBatch(matrices.size(), matrices.empty() ? 0 : matrices[0].n_rows(),
+                  matrices.empty() ? 0 : matrices[0].n_cols()) {
+  for (size_t index = 0; index < this->count; ++index) {
+    set_matrix(index, matrices[index]);
+  }
+}
+
+size_t MatrixBatch::size() const {
+  return this->count;
+}
+
+size_t MatrixBatch::n_rows() const {
+  return this->rows;
+}
+
+size_t MatrixBatch::n_cols() const {
+  return this->cols;
+}
+
+size_t MatrixBatch::n_tiles() const {
+  return this->storage.n_rows();
+}
+
+double *MatrixBatch::tile(size_t index) {
+  return this->storage[index];
+}
+
+const double *MatrixBatch::tile(size_t index) const {
+  return this->storage[index];
+}
+
+void MatrixBatch::check_index(size_t index) const {
+  if (index >= this->count) {
+    throw OutOfBoundsException();
+  }
+}
+
+double &MatrixBatch::element(size_t index, size_t row, size_t col) {
+  return this->storage[index / BATCH_LANES][(row * this->cols + col) * BATCH_LANES +
+                                            index % BATCH_LANES];
+}
+
+const double &MatrixBatch::element(size_t index, size_t row, size_t col) const {
+  return this->storage[index / BATCH_LANES][(row * this->cols + col) * BATCH_LANES +
+                                            index % BATCH_LANES];
+}
+
+double MatrixBatch::get(size_t index, size_t row, size_t col) const {
+  check_index(index);
+  if (row >= this->rows || col >= this->cols) {
+    throw OutOfBoundsException();
+  }
+  return element(index, row, col);
+}
+
+void MatrixBatch::set(size_t index, size_t row, size_t col, double value) {
+  check_index(index);
+  if (row >= this->rows || col >= this->cols) {
+    throw OutOfBoundsException();
+  }
+  element(index, row, col) = value;
+}
+
+Matrix MatrixBatch::matrix(size_t index) const {
+  check_index(index);
+  Matrix result(this->rows, this->cols);
+  for (size_t i = 0; i < this->rows; ++i) {
+    for (size_t j = 0; j < this->cols; ++j) {
+      result[i][j] = element(index, i, j);
+    }
+  }
+  return result;
+}
+
+void MatrixBatch::set_matrix(size_t index, const Matrix &matrix) {
+  check_index(index);
+  if (matrix.n_rows() != this->rows || matrix.n_cols() != this->cols) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < this->rows; ++i) {
+    for (size_t j = 0; j < this->cols; ++j) {
+      element(index, i, j) = matrix.at(i, j);
+    }
+  }
+}
+
+void MatrixBatch::reshape(size_t new_count, size_t new_rows, size_t new_cols) {
+  this->count = new_count;
+  this->rows = new_rows;
+  this->cols = new_cols;
+  this->storage.resize(tiles(new_count), new_rows * new_cols * BATCH_LANES);
+}
+
+MatrixBatch MatrixBatch::operator*(const MatrixBatch &a) const {
+  MatrixBatch result(0, 0, 0);
+  result.multiply(*this, a);
+  return result;
+}
+
+void MatrixBatch::multiply(const MatrixBatch &a, const MatrixBatch &b) {
+  if (a.count != b.count || a.cols != b.rows) {
+    throw SizeMismatchException();
+  }
+  if (this == &a || this == &b) {
+    *this = a * b;
+    return;
+  }
+  size_t m = a.rows;
+  size_t n = b.cols;
+  size_t k = a.cols;
+  reshape(a.count, m, n);
+  if (m * n == 0) {
+    return;
+  }
+  const BatchKernels &kernels = batch_kernels();
+  parallel_for(0, n_tiles(), this->count * m * n * k, [&](size_t first, size_t last) {
+    kernels.multiply(first, last, m, n, k, a.storage.data(), a.storage.leading_dim(),
+                     b.storage.data(), b.storage.leading_dim(), this->storage.data(),
+                     this->storage.leading_dim());
+  });
+}
+
+MatrixBatch MatrixBatch::transposed() const {
+  MatrixBatch result(this->count, this->cols, this->rows);
+  parallel_for(0, n_tiles(), this->count * this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t t = first; t < last; ++t) {
+      const double *source = tile(t);
+      double *target = result.tile(t);
+      for (size_t i = 0; i < this->rows; ++i) {
+        for (size_t j = 0; j < this->cols; ++j) {
+          std::memcpy(target + (j * this->rows + i) * BATCH_LANES,
+                      source + (i * this->cols + j) * BATCH_LANES, BATCH_LANES * sizeof(double));
+        }
+      }
+    }
+  });
+  return result;
+}
+
+std::vector<double> MatrixBatch::det() const {
+  if (this->rows != this->cols) {
+    throw SizeMismatchException();
+  }
+  size_t n = this->rows;
+  std::vector<double> result(n_tiles() * BATCH_LANES, 1.0);
+  if (n > 0) {
+    const BatchKernels &kernels = batch_kernels();
+    parallel_for(0, n_tiles(), this->count * n * n * n, [&](size_t first, size_t last) {
+      std::pmr::vector<double> work(n * n * BATCH_LANES, scratch_resource());
+      kernels.det(first, last, n, this->storage.data(), this->storage.leading_dim(), work.data(),
+                  result.data());
+    });
+  }
+  result.resize(this->count);
+  return result;
+}
+
+std::vector<double> MatrixBatch::trace() const {
+  if (this->rows != this->cols) {
+    throw SizeMismatchException();
+  }
+  std::vector<double> result(n_tiles() * BATCH_LANES, 0.0);
+  for (size_t t = 0; t < n_tiles(); ++t) {
+    for (size_t i = 0; i < this->rows; ++i) {
+      kernels::add(result.data() + t * BATCH_LANES, tile(t) + (i * this->cols + i) * BATCH_LANES,
+                   BATCH_LANES);
+    }
+  }
+  result.resize(this->count);
+  return result;
+}
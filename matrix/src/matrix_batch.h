@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include "matrix.h"
+
+namespace task {
+
+// Matrices of a batch processed together by one SIMD pass.
+const size_t BATCH_LANES = 8;
+
+// count matrices of the same rows x cols shape stored structure-of-arrays in tiles of
+// BATCH_LANES matrices: inside a tile every element position (i, j) holds one contiguous
+// vector of that element across the tile's matrices, so the kernels run the scalar algorithm
+// on BATCH_LANES matrices at a time while each tile stays compact in cache.
+class MatrixBatch {
+
+ public:
+
+  // count zero matrices.
+  MatrixBatch(size_t count, size_t rows, size_t cols);
+  // Throws SizeMismatchException unless all matrices share one shape.
+  explicit MatrixBatch(const std::vector<Matrix> &matrices);
+
+  size_t size() const;
+  size_t n_rows() const;
+  size_t n_cols() const;
+
+  double get(size_t index, size_t row, size_t col) const;
+  void set(size_t index, size_t row, size_t col, double value);
+  Matrix matrix(size_t index) const;
+  void set_matrix(size_t index, const Matrix &matrix);
+
+  size_t n_tiles() const;
+  // rows * cols vectors of BATCH_LANES elements in row-major order; the last tile is
+  // padded with zero matrices.
+  double *tile(size_t index);
+  const double *tile(size_t index) const;
+
+  // Pairwise products; throws SizeMismatchException on different batch sizes or shapes.
+  MatrixBatch operator*(const MatrixBatch &a) const;
+  // Reshapes to the product of a and b in place, reusing the buffer when it is large enough.
+  void multiply(const MatrixBatch &a, const MatrixBatch &b);
+  MatrixBatch transposed() const;
+  std::vector<double> det() const;
+  std::vector<double> trace() const;
+
+ private:
+
+  void check_index(size_t index) const;
+  void reshape(size_t new_count, size_t new_rows, size_t new_cols);
+  double &element(size_t index, size_t row, size_t col);
+  const double &element(size_t index, size_t row, size_t col) const;
+
+  size_t count;
+  size_t rows;
+  size_t cols;
+  // One row per tile.
+  Matrix storage;
+
+};
+
+}  // namespace task
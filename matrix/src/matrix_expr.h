@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include "exceptions.h"
+
+namespace task {
+
+class Matrix;
+struct DenseOperand;
+
+// CRTP base of everything that can appear in a lazy element-wise Matrix expression.
+// Nodes expose n_rows(), n_cols(), an unchecked at(row, col) and aliases(target), which
+// tells whether a leaf reads storage that assigning to `target` would overwrite out of
+// order; nothing is computed until the expression is assigned to a Matrix.
+template <class E>
+class MatrixExpr {
+
+ public:
+
+  const E &self() const {
+    return static_cast<const E &>(*this);
+  }
+
+};
+
+template <class E>
+struct is_matrix_expr : std::is_base_of<MatrixExpr<E>, E> {};
+
+template <class... E>
+using enable_if_matrix_expr = std::enable_if_t<(is_matrix_expr<E>::value && ...)>;
+
+// Matrices are held by reference, intermediate nodes by value.
+template <class E>
+struct expr_operand {
+  using type = const E;
+};
+
+template <>
+struct expr_operand<Matrix> {
+  using type = const Matrix &;
+};
+
+struct ExprPlus {
+  static double apply(double left, double right) {
+    return left + right;
+  }
+};
+
+struct ExprMinus {
+  static double apply(double left, double right) {
+    return left - right;
+  }
+};
+
+template <class L, class R, class Op>
+class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<L, R, Op>> {
+
+ public:
+
+  MatrixBinaryExpr(const L &left, const R &right) : left(left), right(right) {
+    if (left.n_rows() != right.n_rows() || left.n_cols() != right.n_cols()) {
+      throw SizeMismatchException();
+    }
+  }
+
+  size_t n_rows() const {
+    return this->left.n_rows();
+  }
+
+  size_t n_cols() const {
+    return this->left.n_cols();
+  }
+
+  double at(size_t row, size_t col) const {
+    return Op::apply(this->left.at(row, col), this->right.at(row, col));
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return this->left.aliases(target) || this->right.aliases(target);
+  }
+
+ private:
+
+  typename expr_operand<L>::type left;
+  typename expr_operand<R>::type right;
+
+};
+
+template <class E>
+class MatrixScaledExpr : public MatrixExpr<MatrixScaledExpr<E>> {
+
+ public:
+
+  MatrixScaledExpr(const E &source, double factor) : source(source), factor(factor) {}
+
+  size_t n_rows() const {
+    return this->source.n_rows();
+  }
+
+  size_t n_cols() const {
+    return this->source.n_cols();
+  }
+
+  double at(size_t row, size_t col) const {
+    return this->factor * this->source.at(row, col);
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return this->source.aliases(target);
+  }
+
+ private:
+
+  typename expr_operand<E>::type source;
+  double factor;
+
+};
+
+template <class E>
+class MatrixNegatedExpr : public MatrixExpr<MatrixNegatedExpr<E>> {
+
+ public:
+
+  explicit MatrixNegatedExpr(const E &source) : source(source) {}
+
+  size_t n_rows() const {
+    return this->source.n_rows();
+  }
+
+  size_t n_cols() const {
+    return this->source.n_cols();
+  }
+
+  double at(size_t row, size_t col) const {
+    return -this->source.at(row, col);
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return this->source.aliases(target);
+  }
+
+ private:
+
+  typename expr_operand<E>::type source;
+
+};
+
+}  // namespace task
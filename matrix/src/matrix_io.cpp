@@ -0,0 +1,196 @@
+#include "matrix_io.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace task;
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+}  // namespace
+
+PayloadChecksum::PayloadChecksum() : hash(FNV_OFFSET) {}
+
+void PayloadChecksum::update(const double *values, size_t count) {
+  uint64_t h = this->hash;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t word;
+    std::memcpy(&word, values + i, sizeof(word));
+    h = (h ^ word) * FNV_PRIME;
+  }
+  this->hash = h;
+}
+
+uint64_t PayloadChecksum::value() const {
+  return this->hash;
+}
+
+MatrixWriter::MatrixWriter(const std::string &path, size_t cols)
+    : file(std::fopen(path.c_str(), "wb")), cols(cols), stride(Matrix::aligned_stride(cols)),
+      rows(0), padded_row(Matrix::aligned_stride(cols), 0.0) {
+  if (this->file == nullptr) {
+    throw MatrixFileException();
+  }
+  MatrixFileHeader header{};
+  if (std::fwrite(&header, sizeof(header), 1, this->file) != 1) {
+    std::fclose(this->file);
+    throw MatrixFileException();
+  }
+}
+
+MatrixWriter::~MatrixWriter() {
+  if (this->file != nullptr) {
+    try {
+      close();
+    } catch (const MatrixFileException &) {
+    }
+  }
+}
+
+void MatrixWriter::write_row(const double *values) {
+  if (this->file == nullptr) {
+    throw MatrixFileException();
+  }
+  std::copy(values, values + this->cols, this->padded_row.begin());
+  if (std::fwrite(this->padded_row.data(), sizeof(double), this->stride, this->file) != this->stride) {
+    throw MatrixFileException();
+  }
+  this->checksum.update(this->padded_row.data(), this->stride);
+  ++this->rows;
+}
+
+void MatrixWriter::write_rows(const ConstSubMatrixView &block) {
+  if (block.n_cols() != this->cols) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < block.n_rows(); ++i) {
+    write_row(block[i]);
+  }
+}
+
+void MatrixWriter::close() {
+  if (this->file == nullptr) {
+    return;
+  }
+  MatrixFileHeader header{};
+  std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+  header.version = MATRIX_FILE_VERSION;
+  header.dtype = MATRIX_DTYPE_FLOAT64;
+  header.header_size = sizeof(MatrixFileHeader);
+  header.rows = this->rows;
+  header.cols = this->cols;
+  header.stride = this->stride;
+  header.checksum = this->checksum.value();
+  bool ok = std::fseek(this->file, 0, SEEK_SET) == 0 &&
+      std::fwrite(&header, sizeof(header), 1, this->file) == 1;
+  ok = std::fclose(this->file) == 0 && ok;
+  this->file = nullptr;
+  if (!ok) {
+    throw MatrixFileException();
+  }
+}
+
+MappedMatrix::MappedMatrix(const std::string &path)
+    : mapping(nullptr), mapping_size(0), payload(nullptr), rows(0), cols(0), stride(0), checksum(0) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw MatrixFileException();
+  }
+  struct stat info{};
+  if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(MatrixFileHeader)) {
+    ::close(fd);
+    throw MatrixFileException();
+  }
+  this->mapping_size = static_cast<size_t>(info.st_size);
+  this->mapping = ::mmap(nullptr, this->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (this->mapping == MAP_FAILED) {
+    this->mapping = nullptr;
+    throw MatrixFileException();
+  }
+  MatrixFileHeader header{};
+  std::memcpy(&header, this->mapping, sizeof(header));
+  bool valid = std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.version == MATRIX_FILE_VERSION &&
+      header.dtype == MATRIX_DTYPE_FLOAT64 &&
+      header.header_size == sizeof(MatrixFileHeader) &&
+      header.stride >= header.cols &&
+      (this->mapping_size - sizeof(header)) / sizeof(double) / std::max<uint64_t>(header.stride, 1)
+          >= header.rows;
+  if (!valid) {
+    ::munmap(this->mapping, this->mapping_size);
+    throw MatrixFileException();
+  }
+  this->payload = reinterpret_cast<const double *>(static_cast<const char *>(this->mapping) +
+                                                   header.header_size);
+  this->rows = header.rows;
+  this->cols = header.cols;
+  this->stride = header.stride;
+  this->checksum = header.checksum;
+}
+
+MappedMatrix::MappedMatrix(MappedMatrix &&other) noexcept
+    : mapping(other.mapping), mapping_size(other.mapping_size), payload(other.payload),
+      rows(other.rows), cols(other.cols), stride(other.stride), checksum(other.checksum) {
+  other.mapping = nullptr;
+  other.mapping_size = 0;
+  other.payload = nullptr;
+  other.rows = 0;
+  other.cols = 0;
+}
+
+MappedMatrix::~MappedMatrix() {
+  if (this->mapping != nullptr) {
+    ::munmap(this->mapping, this->mapping_size);
+  }
+}
+
+size_t MappedMatrix::n_rows() const {
+  return this->rows;
+}
+
+size_t MappedMatrix::n_cols() const {
+  return this->cols;
+}
+
+size_t MappedMatrix::leading_dim() const {
+  return this->stride;
+}
+
+const double *MappedMatrix::data() const {
+  return this->payload;
+}
+
+const double *MappedMatrix::operator[](size_t row) const {
+  return this->payload + row * this->stride;
+}
+
+ConstSubMatrixView MappedMatrix::view() const {
+  return ConstSubMatrixView(this->payload, this->rows, this->cols, this->stride);
+}
+
+bool MappedMatrix::verify() const {
+  PayloadChecksum actual;
+  actual.update(this->payload, this->rows * this->stride);
+  return actual.value() == this->checksum;
+}
+
+void task::save_binary(const Matrix &matrix, const std::string &path) {
+  MatrixWriter writer(path, matrix.n_cols());
+  writer.write_rows(matrix.view());
+  writer.close();
+}
+
+Matrix task::load_binary(const std::string &path) {
+  MappedMatrix mapped(path);
+  if (!mapped.verify()) {
+    throw MatrixFileException();
+  }
+  return Matrix(mapped.view());
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "matrix.h"
+
+namespace task {
+
+const char MATRIX_FILE_MAGIC[4] = {'T', 'M', 'A', 'T'};
+const uint32_t MATRIX_FILE_VERSION = 1;
+const uint32_t MATRIX_DTYPE_FLOAT64 = 1;
+
+// On-disk layout: this 64-byte header followed by rows * stride doubles in native byte order.
+// Rows keep the in-memory padding, so a mapped payload is already 64-byte aligned per row.
+// The checksum covers the payload including padding.
+struct MatrixFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t dtype;
+  uint32_t header_size;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t stride;
+  uint64_t checksum;
+  uint64_t reserved[2];
+};
+
+static_assert(sizeof(MatrixFileHeader) == MATRIX_ALIGNMENT, "header must keep the payload aligned");
+
+// Running checksum (FNV-1a over 64-bit words) of a matrix payload.
+class PayloadChecksum {
+
+ public:
+
+  PayloadChecksum();
+
+  void update(const double *values, size_t count);
+  uint64_t value() const;
+
+ private:
+
+  uint64_t hash;
+
+};
+
+// Writes a matrix file row by row, so only one row has to be in memory at a time.
+// Rows and the checksum are patched into the header by close(); writing after it throws.
+class MatrixWriter {
+
+ public:
+
+  MatrixWriter(const std::string &path, size_t cols);
+  MatrixWriter(const MatrixWriter &) = delete;
+  MatrixWriter &operator=(const MatrixWriter &) = delete;
+  ~MatrixWriter();
+
+  void write_row(const double *values);
+  void write_rows(const ConstSubMatrixView &block);
+  void close();
+
+ private:
+
+  std::FILE *file;
+  size_t cols;
+  size_t stride;
+  size_t rows;
+  std::vector<double> padded_row;
+  PayloadChecksum checksum;
+
+};
+
+// Read-only matrix backed by a memory-mapped file; pages are loaded on first touch.
+class MappedMatrix : public MatrixExpr<MappedMatrix> {
+
+ public:
+
+  explicit MappedMatrix(const std::string &path);
+  MappedMatrix(MappedMatrix &&other) noexcept;
+  MappedMatrix(const MappedMatrix &) = delete;
+  MappedMatrix &operator=(const MappedMatrix &) = delete;
+  ~MappedMatrix();
+
+  size_t n_rows() const;
+  size_t n_cols() const;
+  size_t leading_dim() const;
+  const double *data() const;
+  const double *operator[](size_t row) const;
+  ConstSubMatrixView view() const;
+
+  double at(size_t row, size_t col) const {
+    return *(this->payload + row * this->stride + col);
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return aliased({this->payload, this->rows, this->cols, this->stride, false}, target);
+  }
+
+  // Recomputes the payload checksum and compares it with the header; touches every page.
+  bool verify() const;
+
+ private:
+
+  void *mapping;
+  size_t mapping_size;
+  const double *payload;
+  size_t rows;
+  size_t cols;
+  size_t stride;
+  uint64_t checksum;
+
+};
+
+template <>
+struct expr_operand<MappedMatrix> {
+  using type = const MappedMatrix &;
+};
+
+template <>
+struct has_dense_operand<MappedMatrix> : std::true_type {};
+
+inline DenseOperand dense_operand(const MappedMatrix &matrix) {
+  return {matrix.data(), matrix.n_rows(), matrix.n_cols(), matrix.leading_dim(), false};
+}
+
+void save_binary(const Matrix &matrix, const std::string &path);
+// Reads a matrix file into memory and verifies its checksum.
+Matrix load_binary(const std::string &path);
+
+}  // namespace task
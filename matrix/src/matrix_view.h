@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "exceptions.h"
+#include "matrix_expr.h"
+
+namespace task {
+
+// Non-owning strided view of matrix elements: a row (step 1) or a column (step = leading dimension).
+template <class T>
+class VectorView {
+
+ public:
+
+  VectorView(T *first, size_t size, size_t step) : first(first), length(size), step_size(step) {}
+
+  template <class U, class = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+  VectorView(const VectorView<U> &other)
+      : first(other.data()), length(other.size()), step_size(other.step()) {}
+
+  T &operator[](size_t i) const {
+    return *(this->first + i * this->step_size);
+  }
+
+  size_t size() const {
+    return this->length;
+  }
+
+  size_t step() const {
+    return this->step_size;
+  }
+
+  T *data() const {
+    return this->first;
+  }
+
+  std::vector<std::remove_const_t<T>> to_vector() const {
+    std::vector<std::remove_const_t<T>> result(this->length);
+    for (size_t i = 0; i < this->length; ++i) {
+      result[i] = (*this)[i];
+    }
+    return result;
+  }
+
+ private:
+
+  T *first;
+  size_t length;
+  size_t step_size;
+
+};
+
+using RowView = VectorView<double>;
+using ConstRowView = VectorView<const double>;
+using ColView = VectorView<double>;
+using ConstColView = VectorView<const double>;
+
+// Storage of a product operand as gemm reads it: rows x cols of op(data), where op is a
+// transpose when `transposed` is set.
+struct DenseOperand {
+  const double *data;
+  size_t rows;
+  size_t cols;
+  size_t ld;
+  bool transposed;
+};
+
+// True when the storage of `source` overlaps that of `target` other than element for element,
+// i.e. when writing `target` in order can change elements of `source` not yet read.
+inline bool aliased(const DenseOperand &source, const DenseOperand &target) {
+  if (source.rows == 0 || source.cols == 0 || target.rows == 0 || target.cols == 0) {
+    return false;
+  }
+  if (source.data == target.data && source.rows == target.rows && source.cols == target.cols &&
+      source.ld == target.ld && source.transposed == target.transposed) {
+    return false;
+  }
+  auto last = [](const DenseOperand &operand) {
+    size_t rows = operand.transposed ? operand.cols : operand.rows;
+    size_t cols = operand.transposed ? operand.rows : operand.cols;
+    return operand.data + (rows - 1) * operand.ld + cols;
+  };
+  std::less<const double *> less;
+  return less(source.data, last(target)) && less(target.data, last(source));
+}
+
+// Lazy transpose of read-only storage: element (i, j) is element (j, i) of the source.
+// Products consume it directly, without materializing the transpose.
+class TransposedView : public MatrixExpr<TransposedView> {
+
+ public:
+
+  TransposedView(const double *source, size_t source_rows, size_t source_cols, size_t stride)
+      : source(source), rows(source_cols), cols(source_rows), stride(stride) {}
+
+  size_t n_rows() const {
+    return this->rows;
+  }
+
+  size_t n_cols() const {
+    return this->cols;
+  }
+
+  size_t leading_dim() const {
+    return this->stride;
+  }
+
+  const double *data() const {
+    return this->source;
+  }
+
+  double at(size_t row, size_t col) const {
+    return *(this->source + col * this->stride + row);
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return aliased({this->source, this->rows, this->cols, this->stride, true}, target);
+  }
+
+ private:
+
+  const double *source;
+  size_t rows;
+  size_t cols;
+  size_t stride;
+
+};
+
+// Non-owning rectangular block of a matrix with its own leading dimension.
+// A view is a lazy expression leaf, and a view of mutable storage can be updated in place.
+// Sources overlapping the destination must be the same block or disjoint from it.
+template <class T>
+class MatrixView : public MatrixExpr<MatrixView<T>> {
+
+ public:
+
+  MatrixView(T *first, size_t rows, size_t cols, size_t stride)
+      : first(first), rows(rows), cols(cols), stride(stride) {}
+
+  template <class U, class = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+  MatrixView(const MatrixView<U> &other)
+      : first(other.data()), rows(other.n_rows()), cols(other.n_cols()), stride(other.leading_dim()) {}
+
+  MatrixView(const MatrixView &other) = default;
+
+  MatrixView &operator=(const MatrixView &other) {
+    return assign<MatrixView, ExprAssign>(other);
+  }
+
+  template <class E, class = enable_if_matrix_expr<E>>
+  MatrixView &operator=(const E &expr) {
+    return assign<E, ExprAssign>(expr);
+  }
+
+  template <class E, class = enable_if_matrix_expr<E>>
+  MatrixView &operator+=(const E &expr) {
+    return assign<E, ExprPlus>(expr);
+  }
+
+  template <class E, class = enable_if_matrix_expr<E>>
+  MatrixView &operator-=(const E &expr) {
+    return assign<E, ExprMinus>(expr);
+  }
+
+  MatrixView &operator*=(const double &number) {
+    for (size_t i = 0; i < this->rows; ++i) {
+      T *row = (*this)[i];
+      for (size_t j = 0; j < this->cols; ++j) {
+        *(row + j) *= number;
+      }
+    }
+    return *this;
+  }
+
+  size_t n_rows() const {
+    return this->rows;
+  }
+
+  size_t n_cols() const {
+    return this->cols;
+  }
+
+  size_t leading_dim() const {
+    return this->stride;
+  }
+
+  T *data() const {
+    return this->first;
+  }
+
+  T *operator[](size_t row) const {
+    return this->first + row * this->stride;
+  }
+
+  double at(size_t row, size_t col) const {
+    return *(this->first + row * this->stride + col);
+  }
+
+  bool aliases(const DenseOperand &target) const {
+    return aliased({this->first, this->rows, this->cols, this->stride, false}, target);
+  }
+
+  VectorView<T> row(size_t row) const {
+    if (row >= this->rows) {
+      throw OutOfBoundsException();
+    }
+    return VectorView<T>((*this)[row], this->cols, 1);
+  }
+
+  VectorView<T> col(size_t col) const {
+    if (col >= this->cols) {
+      throw OutOfBoundsException();
+    }
+    return VectorView<T>(this->first + col, this->rows, this->stride);
+  }
+
+  TransposedView transposed_view() const {
+    return TransposedView(this->first, this->rows, this->cols, this->stride);
+  }
+
+  MatrixView block(size_t row, size_t col, size_t n_rows, size_t n_cols) const {
+    if (row + n_rows > this->rows || col + n_cols > this->cols) {
+      throw OutOfBoundsException();
+    }
+    return MatrixView(this->first + row * this->stride + col, n_rows, n_cols, this->stride);
+  }
+
+ private:
+
+  struct ExprAssign {
+    static double apply(double, double right) {
+      return right;
+    }
+  };
+
+  template <class E, class Op>
+  MatrixView &assign(const E &expr) {
+    if (this->rows != expr.n_rows() || this->cols != expr.n_cols()) {
+      throw SizeMismatchException();
+    }
+    for (size_t i = 0; i < this->rows; ++i) {
+      T *row = (*this)[i];
+#pragma GCC ivdep
+      for (size_t j = 0; j < this->cols; ++j) {
+        *(row + j) = Op::apply(*(row + j), expr.at(i, j));
+      }
+    }
+    return *this;
+  }
+
+  T *first;
+  size_t rows;
+  size_t cols;
+  size_t stride;
+
+};
+
+using SubMatrixView = MatrixView<double>;
+using ConstSubMatrixView = MatrixView<const double>;
+
+template <class E>
+struct has_dense_operand : std::false_type {};
+
+template <class T>
+struct has_dense_operand<MatrixView<T>> : std::true_type {};
+
+template <>
+struct has_dense_operand<TransposedView> : std::true_type {};
+
+template <class T>
+DenseOperand dense_operand(const MatrixView<T> &view) {
+  return {view.data(), view.n_rows(), view.n_cols(), view.leading_dim(), false};
+}
+
+inline DenseOperand dense_operand(const TransposedView &view) {
+  return {view.data(), view.n_rows(), view.n_cols(), view.leading_dim(), true};
+}
+
+}  // namespace task
@@ -0,0 +1,157 @@
+#include "qr.h"
+#include <algorithm>
+#include <cmath>
+#include "gemm.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include "triangular.h"
+
+using namespace task;
+
+QR::QR(const Matrix &a) : qr(a), t(Matrix::zero(QR_BLOCK, a.n_cols())), tau(a.n_cols()) {
+  if (a.n_rows() < a.n_cols()) {
+    throw SizeMismatchException();
+  }
+  factorize();
+}
+
+void QR::factorize() {
+  size_t m = this->qr.n_rows();
+  size_t n = this->qr.n_cols();
+  size_t ld = this->qr.leading_dim();
+  double *a = this->qr.data();
+  std::vector<double> w(QR_BLOCK);
+  for (size_t k0 = 0; k0 < n; k0 += QR_BLOCK) {
+    size_t k_end = std::min(n, k0 + QR_BLOCK);
+    for (size_t k = k0; k < k_end; ++k) {
+      // Reflector H = I - tau * v * v^T with v(k) = 1 mapping column k onto beta * e_k.
+      double alpha = *(a + k * ld + k);
+      double sigma = 0;
+      for (size_t i = k + 1; i < m; ++i) {
+        sigma += *(a + i * ld + k) * *(a + i * ld + k);
+      }
+      if (sigma == 0) {
+        this->tau[k] = 0;
+        continue;
+      }
+      double beta = std::sqrt(alpha * alpha + sigma);
+      beta = alpha > 0 ? -beta : beta;
+      this->tau[k] = (beta - alpha) / beta;
+      double scale = 1 / (alpha - beta);
+      *(a + k * ld + k) = beta;
+      for (size_t i = k + 1; i < m; ++i) {
+        *(a + i * ld + k) *= scale;
+      }
+      size_t width = k_end - k - 1;
+      if (width == 0) {
+        continue;
+      }
+      // Panel columns right of k: w = v^T A, then A -= tau * v * w.
+      std::copy(a + k * ld + k + 1, a + k * ld + k_end, w.begin());
+      for (size_t i = k + 1; i < m; ++i) {
+        kernels::axpy(w.data(), *(a + i * ld + k), a + i * ld + k + 1, width);
+      }
+      double factor = this->tau[k];
+      kernels::axpy(a + k * ld + k + 1, -factor, w.data(), width);
+      parallel_for(k + 1, m, (m - k) * width, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          kernels::axpy(a + i * ld + k + 1, -factor * *(a + i * ld + k), w.data(), width);
+        }
+      });
+    }
+    // T of the panel: T(j, j) = tau_j and T(0:j, j) = -tau_j * T(0:j, 0:j) * V(:, 0:j)^T v_j.
+    Matrix v = reflectors(k0, k_end);
+    size_t kb = k_end - k0;
+    double *t_block = this->t.data() + k0;
+    size_t ldt = this->t.leading_dim();
+    for (size_t j = 0; j < kb; ++j) {
+      std::fill(w.begin(), w.end(), 0.0);
+      for (size_t i = j; i < v.n_rows(); ++i) {
+        kernels::axpy(w.data(), v[i][j], v[i], j);
+      }
+      for (size_t i = 0; i < j; ++i) {
+        double sum = 0;
+        for (size_t p = i; p < j; ++p) {
+          sum += *(t_block + i * ldt + p) * w[p];
+        }
+        *(t_block + i * ldt + j) = -this->tau[k0 + j] * sum;
+      }
+      *(t_block + j * ldt + j) = this->tau[k0 + j];
+    }
+    if (k_end < n) {
+      apply_block(k0, k_end, GemmOp::Transpose, n - k_end, a + k0 * ld + k_end, ld);
+    }
+  }
+}
+
+// V of the panel [k0, k_end) with its implicit unit diagonal and zeros above it, (m - k0) x kb.
+Matrix QR::reflectors(size_t k0, size_t k_end) const {
+  Matrix v = Matrix::zero(this->qr.n_rows() - k0, k_end - k0);
+  for (size_t i = 0; i < v.n_rows(); ++i) {
+    for (size_t j = 0; j < v.n_cols() && j <= i; ++j) {
+      v[i][j] = i == j ? 1.0 : this->qr[k0 + i][k0 + j];
+    }
+  }
+  return v;
+}
+
+// B = (I - V * op(T) * V^T) * B for the rows k0..m of B; op = Transpose applies the panel's
+// part of Q^T, op = None its part of Q.
+void QR::apply_block(size_t k0, size_t k_end, GemmOp op, size_t cols, double *b, size_t ldb) const {
+  Matrix v = reflectors(k0, k_end);
+  size_t kb = k_end - k0;
+  Matrix w = Matrix::zero(kb, cols);
+  Matrix tw = Matrix::zero(kb, cols);
+  gemm(GemmOp::Transpose, GemmOp::None, kb, cols, v.n_rows(), 1.0, v.data(), v.leading_dim(),
+       b, ldb, w.data(), w.leading_dim());
+  gemm(op, GemmOp::None, kb, cols, kb, 1.0, this->t.data() + k0, this->t.leading_dim(),
+       w.data(), w.leading_dim(), tw.data(), tw.leading_dim());
+  gemm(v.n_rows(), cols, kb, -1.0, v.data(), v.leading_dim(), tw.data(), tw.leading_dim(),
+       b, ldb);
+}
+
+Matrix QR::solve(const Matrix &b) const {
+  size_t m = this->qr.n_rows();
+  size_t n = this->qr.n_cols();
+  if (b.n_rows() != m) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (this->qr.get(i, i) == 0) {
+      throw SingularMatrixException();
+    }
+  }
+  Matrix y = b;
+  for (size_t k0 = 0; k0 < n; k0 += QR_BLOCK) {
+    apply_block(k0, std::min(n, k0 + QR_BLOCK), GemmOp::Transpose, y.n_cols(),
+                y.data() + k0 * y.leading_dim(), y.leading_dim());
+  }
+  Matrix x = y.block(0, 0, n, y.n_cols());
+  trsm(Triangle::Upper, GemmOp::None, false, n, x.n_cols(), this->qr.data(),
+       this->qr.leading_dim(), x.data(), x.leading_dim());
+  return x;
+}
+
+std::vector<double> QR::solve(const std::vector<double> &b) const {
+  return column_values(solve(column_matrix(b)));
+}
+
+Matrix QR::q() const {
+  size_t n = this->qr.n_cols();
+  Matrix result(this->qr.n_rows(), n);
+  for (size_t k0 = (n + QR_BLOCK - 1) / QR_BLOCK * QR_BLOCK; k0 > 0;) {
+    k0 -= QR_BLOCK;
+    apply_block(k0, std::min(n, k0 + QR_BLOCK), GemmOp::None, n,
+                result.data() + k0 * result.leading_dim(), result.leading_dim());
+  }
+  return result;
+}
+
+Matrix QR::r() const {
+  size_t n = this->qr.n_cols();
+  Matrix result = Matrix::zero(n, n);
+  for (size_t i = 0; i < n; ++i) {
+    std::copy(this->qr[i] + i, this->qr[i] + n, result[i] + i);
+  }
+  return result;
+}
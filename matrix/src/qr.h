@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "gemm.h"
+#include "matrix.h"
+
+namespace task {
+
+const size_t QR_BLOCK = 32;
+
+// Householder factorization A = Q * R of an m x n matrix with m >= n. Reflectors are kept
+// below the diagonal of R; each QR_BLOCK-wide panel also keeps the triangular factor T of its
+// compact WY form I - V * T * V^T, so Q and Q^T are applied with gemm.
+class QR {
+
+ public:
+
+  explicit QR(const Matrix &a);
+
+  // Least squares solution of min |A x - b| for every column of b; throws
+  // SingularMatrixException when R has a zero on its diagonal.
+  Matrix solve(const Matrix &b) const;
+  std::vector<double> solve(const std::vector<double> &b) const;
+
+  // Thin factors: Q is m x n with orthonormal columns, R is n x n upper triangular.
+  Matrix q() const;
+  Matrix r() const;
+
+ private:
+
+  void factorize();
+  Matrix reflectors(size_t k0, size_t k_end) const;
+  void apply_block(size_t k0, size_t k_end, GemmOp op, size_t cols, double *b, size_t ldb) const;
+
+  Matrix qr;
+  Matrix t;
+  std::vector<double> tau;
+
+};
+
+}  // namespace task
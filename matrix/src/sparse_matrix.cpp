@@ -0,0 +1,320 @@
+#include "sparse_matrix.h"
+#include <algorithm>
+#include <cmath>
+#include "kernels.h"
+#include "thread_pool.h"
+
+using namespace task;
+
+namespace {
+
+// Turns per-slice counts stored at starts[1..outer] into slice offsets.
+void accumulate_offsets(std::vector<size_t> &starts) {
+  for (size_t o = 1; o < starts.size(); ++o) {
+    starts[o] += starts[o - 1];
+  }
+}
+
+}  // namespace
+
+SparseMatrix::SparseMatrix() : SparseMatrix(0, 0) {}
+
+SparseMatrix::SparseMatrix(size_t rows, size_t cols, SparseLayout layout)
+    : rows(rows), cols(cols), storage(layout),
+      starts((layout == SparseLayout::CSR ? rows : cols) + 1, 0) {}
+
+SparseMatrix::SparseMatrix(const Matrix &dense, SparseLayout layout, double tolerance)
+    : SparseMatrix(dense.n_rows(), dense.n_cols()) {
+  auto keep = [tolerance](double value) {
+    return !(std::fabs(value) <= tolerance);
+  };
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      const double *row = dense[i];
+      this->starts[i + 1] = std::count_if(row, row + this->cols, keep);
+    }
+  });
+  accumulate_offsets(this->starts);
+  this->inner.resize(this->starts[this->rows]);
+  this->data.resize(this->starts[this->rows]);
+  parallel_for(0, this->rows, this->rows * this->cols, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      const double *row = dense[i];
+      size_t p = this->starts[i];
+      for (size_t j = 0; j < this->cols; ++j) {
+        if (keep(*(row + j))) {
+          this->inner[p] = j;
+          this->data[p] = *(row + j);
+          ++p;
+        }
+      }
+    }
+  });
+  if (layout == SparseLayout::CSC) {
+    *this = to_layout(SparseLayout::CSC);
+  }
+}
+
+SparseMatrix SparseMatrix::from_entries(size_t rows, size_t cols, std::vector<SparseEntry> entries,
+                                        SparseLayout layout) {
+  SparseMatrix result(rows, cols, layout);
+  bool by_rows = layout == SparseLayout::CSR;
+  for (const SparseEntry &entry : entries) {
+    if (entry.row >= rows || entry.col >= cols) {
+      throw OutOfBoundsException();
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [by_rows](const SparseEntry &a, const SparseEntry &b) {
+    if (by_rows) {
+      return a.row != b.row ? a.row < b.row : a.col < b.col;
+    }
+    return a.col != b.col ? a.col < b.col : a.row < b.row;
+  });
+  for (size_t p = 0; p < entries.size();) {
+    size_t outer = by_rows ? entries[p].row : entries[p].col;
+    size_t index = by_rows ? entries[p].col : entries[p].row;
+    double value = 0;
+    size_t q = p;
+    while (q < entries.size() && entries[q].row == entries[p].row && entries[q].col == entries[p].col) {
+      value += entries[q].value;
+      ++q;
+    }
+    p = q;
+    if (value != 0) {
+      result.inner.push_back(index);
+      result.data.push_back(value);
+      ++result.starts[outer + 1];
+    }
+  }
+  accumulate_offsets(result.starts);
+  return result;
+}
+
+size_t SparseMatrix::n_rows() const {
+  return this->rows;
+}
+
+size_t SparseMatrix::n_cols() const {
+  return this->cols;
+}
+
+size_t SparseMatrix::nnz() const {
+  return this->data.size();
+}
+
+SparseLayout SparseMatrix::layout() const {
+  return this->storage;
+}
+
+const std::vector<size_t> &SparseMatrix::offsets() const {
+  return this->starts;
+}
+
+const std::vector<size_t> &SparseMatrix::indices() const {
+  return this->inner;
+}
+
+const std::vector<double> &SparseMatrix::values() const {
+  return this->data;
+}
+
+size_t SparseMatrix::outer_size() const {
+  return this->storage == SparseLayout::CSR ? this->rows : this->cols;
+}
+
+size_t SparseMatrix::inner_size() const {
+  return this->storage == SparseLayout::CSR ? this->cols : this->rows;
+}
+
+double SparseMatrix::get(size_t row, size_t col) const {
+  if (row >= this->rows || col >= this->cols) {
+    throw OutOfBoundsException();
+  }
+  size_t outer = this->storage == SparseLayout::CSR ? row : col;
+  size_t index = this->storage == SparseLayout::CSR ? col : row;
+  auto first = this->inner.begin() + this->starts[outer];
+  auto last = this->inner.begin() + this->starts[outer + 1];
+  auto found = std::lower_bound(first, last, index);
+  if (found == last || *found != index) {
+    return 0;
+  }
+  return this->data[found - this->inner.begin()];
+}
+
+// Counting sort of the entries by their inner index; O(nnz + rows + cols).
+SparseMatrix SparseMatrix::to_layout(SparseLayout target) const {
+  if (target == this->storage) {
+    return *this;
+  }
+  SparseMatrix result(this->rows, this->cols, target);
+  for (size_t index : this->inner) {
+    ++result.starts[index + 1];
+  }
+  accumulate_offsets(result.starts);
+  result.inner.resize(nnz());
+  result.data.resize(nnz());
+  std::vector<size_t> next(result.starts.begin(), result.starts.end() - 1);
+  for (size_t o = 0; o < outer_size(); ++o) {
+    for (size_t p = this->starts[o]; p < this->starts[o + 1]; ++p) {
+      size_t q = next[this->inner[p]]++;
+      result.inner[q] = o;
+      result.data[q] = this->data[p];
+    }
+  }
+  return result;
+}
+
+// CSR storage of A is CSC storage of A^T, so only the shape and the layout tag change.
+SparseMatrix SparseMatrix::transposed() const {
+  SparseMatrix result = *this;
+  std::swap(result.rows, result.cols);
+  result.storage = this->storage == SparseLayout::CSR ? SparseLayout::CSC : SparseLayout::CSR;
+  return result;
+}
+
+Matrix SparseMatrix::to_dense() const {
+  Matrix result = Matrix::zero(this->rows, this->cols);
+  for (size_t o = 0; o < outer_size(); ++o) {
+    for (size_t p = this->starts[o]; p < this->starts[o + 1]; ++p) {
+      if (this->storage == SparseLayout::CSR) {
+        result[o][this->inner[p]] = this->data[p];
+      } else {
+        result[this->inner[p]][o] = this->data[p];
+      }
+    }
+  }
+  return result;
+}
+
+// Outer slice boundaries that give every chunk about SPARSE_CHUNK_NNZ nonzeros. Only the
+// number of nonzeros decides the chunks, so skewed rows do not unbalance the threads.
+std::vector<size_t> SparseMatrix::partition() const {
+  size_t chunks = std::max<size_t>(1, (nnz() + SPARSE_CHUNK_NNZ - 1) / SPARSE_CHUNK_NNZ);
+  std::vector<size_t> bounds(chunks + 1, outer_size());
+  bounds[0] = 0;
+  for (size_t c = 1; c < chunks; ++c) {
+    size_t target = c * nnz() / chunks;
+    bounds[c] = std::lower_bound(this->starts.begin(), this->starts.end(), target)
+        - this->starts.begin();
+    bounds[c] = std::max(bounds[c], bounds[c - 1]);
+  }
+  return bounds;
+}
+
+std::vector<double> SparseMatrix::operator*(const std::vector<double> &x) const {
+  if (x.size() != this->cols) {
+    throw SizeMismatchException();
+  }
+  std::vector<double> y(this->rows, 0.0);
+  if (this->storage == SparseLayout::CSC) {
+    for (size_t j = 0; j < this->cols; ++j) {
+      for (size_t p = this->starts[j]; p < this->starts[j + 1]; ++p) {
+        y[this->inner[p]] += this->data[p] * x[j];
+      }
+    }
+    return y;
+  }
+  std::vector<size_t> bounds = partition();
+  parallel_for(0, bounds.size() - 1, nnz(), [&](size_t first, size_t last) {
+    for (size_t i = bounds[first]; i < bounds[last]; ++i) {
+      double sum = 0;
+      for (size_t p = this->starts[i]; p < this->starts[i + 1]; ++p) {
+        sum += this->data[p] * x[this->inner[p]];
+      }
+      y[i] = sum;
+    }
+  });
+  return y;
+}
+
+Matrix SparseMatrix::operator*(const Matrix &a) const {
+  if (a.n_rows() != this->cols) {
+    throw SizeMismatchException();
+  }
+  size_t n = a.n_cols();
+  Matrix result = Matrix::zero(this->rows, n);
+  if (this->storage == SparseLayout::CSC) {
+    for (size_t k = 0; k < this->cols; ++k) {
+      for (size_t p = this->starts[k]; p < this->starts[k + 1]; ++p) {
+        kernels::axpy(result[this->inner[p]], this->data[p], a[k], n);
+      }
+    }
+    return result;
+  }
+  std::vector<size_t> bounds = partition();
+  parallel_for(0, bounds.size() - 1, nnz() * n, [&](size_t first, size_t last) {
+    for (size_t i = bounds[first]; i < bounds[last]; ++i) {
+      for (size_t p = this->starts[i]; p < this->starts[i + 1]; ++p) {
+        kernels::axpy(result[i], this->data[p], a[this->inner[p]], n);
+      }
+    }
+  });
+  return result;
+}
+
+// Two passes over the merged slices: the first counts the surviving entries of every slice,
+// the second writes them at their final offsets, so both run in parallel without locking.
+template <class Op>
+SparseMatrix SparseMatrix::merge(const SparseMatrix &a) const {
+  if (this->rows != a.rows || this->cols != a.cols) {
+    throw SizeMismatchException();
+  }
+  SparseMatrix converted;
+  if (a.storage != this->storage) {
+    converted = a.to_layout(this->storage);
+  }
+  const SparseMatrix &right = a.storage == this->storage ? a : converted;
+  SparseMatrix result(this->rows, this->cols, this->storage);
+  auto walk = [&](size_t o, auto &&emit) {
+    size_t p = this->starts[o];
+    size_t q = right.starts[o];
+    while (p < this->starts[o + 1] || q < right.starts[o + 1]) {
+      size_t left_index = p < this->starts[o + 1] ? this->inner[p] : inner_size();
+      size_t right_index = q < right.starts[o + 1] ? right.inner[q] : inner_size();
+      double value;
+      size_t index = std::min(left_index, right_index);
+      if (left_index == right_index) {
+        value = Op::apply(this->data[p++], right.data[q++]);
+      } else if (left_index < right_index) {
+        value = Op::apply(this->data[p++], 0.0);
+      } else {
+        value = Op::apply(0.0, right.data[q++]);
+      }
+      if (value != 0) {
+        emit(index, value);
+      }
+    }
+  };
+  size_t work = nnz() + right.nnz();
+  parallel_for(0, outer_size(), work, [&](size_t first, size_t last) {
+    for (size_t o = first; o < last; ++o) {
+      size_t count = 0;
+      walk(o, [&count](size_t, double) {
+        ++count;
+      });
+      result.starts[o + 1] = count;
+    }
+  });
+  accumulate_offsets(result.starts);
+  result.inner.resize(result.starts[outer_size()]);
+  result.data.resize(result.starts[outer_size()]);
+  parallel_for(0, outer_size(), work, [&](size_t first, size_t last) {
+    for (size_t o = first; o < last; ++o) {
+      size_t position = result.starts[o];
+      walk(o, [&](size_t index, double value) {
+        result.inner[position] = index;
+        result.data[position] = value;
+        ++position;
+      });
+    }
+  });
+  return result;
+}
+
+SparseMatrix SparseMatrix::operator+(const SparseMatrix &a) const {
+  return merge<ExprPlus>(a);
+}
+
+SparseMatrix SparseMatrix::operator-(const SparseMatrix &a) const {
+  return merge<ExprMinus>(a);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include "matrix.h"
+
+namespace task {
+
+// Nonzeros handled by one task of a parallel sparse product; rows are grouped so every task
+// gets about this many, whatever the row lengths.
+const size_t SPARSE_CHUNK_NNZ = 1 << 14;
+
+enum class SparseLayout {
+  CSR,
+  CSC
+};
+
+struct SparseEntry {
+  size_t row;
+  size_t col;
+  double value;
+};
+
+// Compressed sparse matrix. In CSR the outer dimension is rows and indices hold column numbers;
+// CSC is the same with rows and columns swapped. Indices are sorted inside every outer slice
+// and only nonzero values are stored, so memory is O(nnz + outer dimension).
+class SparseMatrix {
+
+ public:
+
+  SparseMatrix();
+  SparseMatrix(size_t rows, size_t cols, SparseLayout layout = SparseLayout::CSR);
+  // Drops the entries with |value| <= tolerance; NaNs are kept.
+  explicit SparseMatrix(const Matrix &dense, SparseLayout layout = SparseLayout::CSR,
+                        double tolerance = 0.0);
+  // Duplicate coordinates are summed; throws OutOfBoundsException for entries outside the shape.
+  static SparseMatrix from_entries(size_t rows, size_t cols, std::vector<SparseEntry> entries,
+                                   SparseLayout layout = SparseLayout::CSR);
+
+  size_t n_rows() const;
+  size_t n_cols() const;
+  size_t nnz() const;
+  SparseLayout layout() const;
+  const std::vector<size_t> &offsets() const;
+  const std::vector<size_t> &indices() const;
+  const std::vector<double> &values() const;
+
+  double get(size_t row, size_t col) const;
+
+  SparseMatrix to_layout(SparseLayout target) const;
+  SparseMatrix transposed() const;
+  Matrix to_dense() const;
+
+  // CSR products are split across threads by nonzeros; CSC products scatter serially.
+  std::vector<double> operator*(const std::vector<double> &x) const;
+  Matrix operator*(const Matrix &a) const;
+
+  // The result has the layout of the left operand; entries that cancel to zero are dropped.
+  SparseMatrix operator+(const SparseMatrix &a) const;
+  SparseMatrix operator-(const SparseMatrix &a) const;
+
+ private:
+
+  size_t outer_size() const;
+  size_t inner_size() const;
+  std::vector<size_t> partition() const;
+  template <class Op>
+  SparseMatrix merge(const SparseMatrix &a) const;
+
+  size_t rows;
+  size_t cols;
+  SparseLayout storage;
+  std::vector<size_t> starts;
+  std::vector<size_t> inner;
+  std::vector<double> data;
+
+};
+
+}  // namespace task
@@ -0,0 +1,233 @@
+#include "strassen.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+#include "gemm.h"
+#include "kernels.h"
+#include "thread_pool.h"
+
+using namespace task;
+
+namespace {
+
+const size_t ARENA_ALIGNMENT = 64;
+
+// Bump allocator for the recursion: each level takes its blocks on entry and hands them back
+// on exit, so after the first call of a given size no allocation happens at all.
+class Arena {
+
+ public:
+
+  void reserve(size_t count) {
+    if (count > this->capacity) {
+      release();
+      this->buffer = static_cast<double *>(::operator new(count * sizeof(double),
+                                                          std::align_val_t(ARENA_ALIGNMENT)));
+      this->capacity = count;
+    }
+    this->top = 0;
+  }
+
+  double *allocate(size_t count) {
+    double *block = this->buffer + this->top;
+    this->top += count;
+    return block;
+  }
+
+  size_t mark() const {
+    return this->top;
+  }
+
+  void rewind(size_t mark) {
+    this->top = mark;
+  }
+
+  ~Arena() {
+    release();
+  }
+
+ private:
+
+  void release() {
+    if (this->buffer != nullptr) {
+      ::operator delete(this->buffer, std::align_val_t(ARENA_ALIGNMENT));
+    }
+    this->buffer = nullptr;
+    this->capacity = 0;
+  }
+
+  double *buffer = nullptr;
+  size_t capacity = 0;
+  size_t top = 0;
+
+};
+
+size_t clamp_crossover(size_t crossover) {
+  return std::max<size_t>(crossover, 1);
+}
+
+// Doubles the recursion takes from the arena for an order n product.
+size_t workspace_size(size_t n, size_t crossover) {
+  size_t total = 0;
+  while (n > crossover) {
+    if (n % 2 == 1) {
+      --n;
+      continue;
+    }
+    n /= 2;
+    total += 2 * n * Matrix::aligned_stride(n);
+  }
+  return total;
+}
+
+// dst = x + y (or x - y when subtract is set) over h x h blocks; dst may alias x or y.
+void combine(double *dst, size_t ldd, const double *x, size_t ldx, const double *y, size_t ldy,
+             size_t h, bool subtract) {
+  parallel_for(0, h, h * h, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      double *row = dst + i * ldd;
+      const double *x_row = x + i * ldx;
+      const double *y_row = y + i * ldy;
+      if (row == y_row) {
+        if (subtract) {
+          kernels::negate(row, row, h);
+        }
+        kernels::add(row, x_row, h);
+        continue;
+      }
+      if (row != x_row) {
+        std::memcpy(row, x_row, h * sizeof(double));
+      }
+      if (subtract) {
+        kernels::sub(row, y_row, h);
+      } else {
+        kernels::add(row, y_row, h);
+      }
+    }
+  });
+}
+
+void classical(size_t m, size_t n, size_t k, const double *a, size_t lda, const double *b,
+               size_t ldb, double *c, size_t ldc) {
+  for (size_t i = 0; i < m; ++i) {
+    std::memset(c + i * ldc, 0, n * sizeof(double));
+  }
+  gemm(m, n, k, 1.0, a, lda, b, ldb, c, ldc);
+}
+
+void multiply(size_t n, const double *a, size_t lda, const double *b, size_t ldb,
+              double *c, size_t ldc, size_t crossover, Arena &arena) {
+  if (n <= crossover) {
+    classical(n, n, n, a, lda, b, ldb, c, ldc);
+    return;
+  }
+  if (n % 2 == 1) {
+    // [A11 a12; a21 a22] * [B11 b12; b21 b22] with A11, B11 of order n - 1.
+    size_t m = n - 1;
+    multiply(m, a, lda, b, ldb, c, ldc, crossover, arena);
+    gemm(m, m, 1, 1.0, a + m, lda, b + m * ldb, ldb, c, ldc);
+    classical(n, 1, n, a, lda, b + m, ldb, c + m, ldc);
+    classical(1, m, n, a + m * lda, lda, b, ldb, c + m * ldc, ldc);
+    return;
+  }
+  size_t h = n / 2;
+  const double *a11 = a;
+  const double *a12 = a + h;
+  const double *a21 = a + h * lda;
+  const double *a22 = a21 + h;
+  const double *b11 = b;
+  const double *b12 = b + h;
+  const double *b21 = b + h * ldb;
+  const double *b22 = b21 + h;
+  double *c11 = c;
+  double *c12 = c + h;
+  double *c21 = c + h * ldc;
+  double *c22 = c21 + h;
+  size_t mark = arena.mark();
+  size_t ld = Matrix::aligned_stride(h);
+  double *x = arena.allocate(h * ld);
+  double *y = arena.allocate(h * ld);
+  // Two-temporary schedule from Boyer, Dumas, Pernet and Zhou, "Memory efficient scheduling
+  // of Strassen-Winograd's matrix multiplication algorithm" (ISSAC 2009), table 1.
+  combine(x, ld, a11, lda, a21, lda, h, true);                    // S3 = A11 - A21
+  combine(y, ld, b22, ldb, b12, ldb, h, true);                    // T3 = B22 - B12
+  multiply(h, x, ld, y, ld, c21, ldc, crossover, arena);          // P7 = S3 T3
+  combine(x, ld, a21, lda, a22, lda, h, false);                   // S1 = A21 + A22
+  combine(y, ld, b12, ldb, b11, ldb, h, true);                    // T1 = B12 - B11
+  multiply(h, x, ld, y, ld, c22, ldc, crossover, arena);          // P5 = S1 T1
+  combine(x, ld, x, ld, a11, lda, h, true);                       // S2 = S1 - A11
+  combine(y, ld, b22, ldb, y, ld, h, true);                       // T2 = B22 - T1
+  multiply(h, x, ld, y, ld, c12, ldc, crossover, arena);          // P6 = S2 T2
+  combine(x, ld, a12, lda, x, ld, h, true);                       // S4 = A12 - S2
+  multiply(h, x, ld, b22, ldb, c11, ldc, crossover, arena);       // P3 = S4 B22
+  multiply(h, a11, lda, b11, ldb, x, ld, crossover, arena);       // P1 = A11 B11
+  combine(c12, ldc, x, ld, c12, ldc, h, false);                   // U2 = P1 + P6
+  combine(c21, ldc, c12, ldc, c21, ldc, h, false);                // U3 = U2 + P7
+  combine(c12, ldc, c12, ldc, c22, ldc, h, false);                // U4 = U2 + P5
+  combine(c22, ldc, c21, ldc, c22, ldc, h, false);                // U7 = U3 + P5
+  combine(c12, ldc, c12, ldc, c11, ldc, h, false);                // U5 = U4 + P3
+  combine(y, ld, y, ld, b21, ldb, h, true);                       // T4 = T2 - B21
+  multiply(h, a22, lda, y, ld, c11, ldc, crossover, arena);       // P4 = A22 T4
+  combine(c21, ldc, c21, ldc, c11, ldc, h, true);                 // U6 = U3 - P4
+  multiply(h, a12, lda, b21, ldb, c11, ldc, crossover, arena);    // P2 = A12 B21
+  combine(c11, ldc, x, ld, c11, ldc, h, false);                   // U1 = P1 + P2
+  arena.rewind(mark);
+}
+
+// Error constants f(n) with max |C - fl(C)| <= f(n) u max|A| max|B|. The classical product
+// has f(n) = n^2; a Winograd level gives f(2h) = 18 f(h) + 96 h (Higham, theorem 23.3), and
+// peeling an odd order adds one more rounded term to the inner block.
+double strassen_constant(size_t n, size_t crossover) {
+  if (n <= crossover) {
+    return static_cast<double>(n) * n;
+  }
+  if (n % 2 == 1) {
+    return std::max(strassen_constant(n - 1, crossover) + n, static_cast<double>(n) * n);
+  }
+  return 18 * strassen_constant(n / 2, crossover) + 48.0 * n;
+}
+
+double max_abs(const Matrix &a) {
+  double result = 0;
+  for (size_t i = 0; i < a.n_rows(); ++i) {
+    for (size_t j = 0; j < a.n_cols(); ++j) {
+      result = std::max(result, std::fabs(a.at(i, j)));
+    }
+  }
+  return result;
+}
+
+void check_square_pair(const Matrix &a, const Matrix &b) {
+  if (a.n_rows() != a.n_cols() || b.n_rows() != b.n_cols() || a.n_rows() != b.n_rows()) {
+    throw SizeMismatchException();
+  }
+}
+
+}  // namespace
+
+void task::strassen(size_t n, const double *a, size_t lda, const double *b, size_t ldb,
+                    double *c, size_t ldc, size_t crossover) {
+  crossover = clamp_crossover(crossover);
+  thread_local Arena arena;
+  arena.reserve(workspace_size(n, crossover));
+  multiply(n, a, lda, b, ldb, c, ldc, crossover, arena);
+}
+
+Matrix task::strassen_multiply(const Matrix &a, const Matrix &b, size_t crossover) {
+  check_square_pair(a, b);
+  size_t n = a.n_rows();
+  Matrix result(n, n);
+  strassen(n, a.data(), a.leading_dim(), b.data(), b.leading_dim(),
+           result.data(), result.leading_dim(), crossover);
+  return result;
+}
+
+ProductErrorBound task::strassen_error_bound(const Matrix &a, const Matrix &b, size_t crossover) {
+  check_square_pair(a, b);
+  size_t n = a.n_rows();
+  double scale = std::numeric_limits<double>::epsilon() / 2 * max_abs(a) * max_abs(b);
+  double classical_constant = static_cast<double>(n) * n;
+  return {strassen_constant(n, clamp_crossover(crossover)) * scale, classical_constant * scale};
+}
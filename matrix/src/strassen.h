@@ -0,0 +1,29 @@
+#pragma once
+
+#include "matrix.h"
+
+namespace task {
+
+// Operands of order at most this size are multiplied by the blocked gemm kernel directly.
+const size_t STRASSEN_CROSSOVER = 512;
+
+// C = A * B for n x n row-major operands using Strassen-Winograd recursion (7 products and
+// 15 additions per level); odd orders peel off their last row and column. Temporaries come
+// from a per-thread arena that is sized once per call.
+void strassen(size_t n, const double *a, size_t lda, const double *b, size_t ldb,
+              double *c, size_t ldc, size_t crossover = STRASSEN_CROSSOVER);
+
+// Throws SizeMismatchException unless a and b are square matrices of the same order.
+Matrix strassen_multiply(const Matrix &a, const Matrix &b, size_t crossover = STRASSEN_CROSSOVER);
+
+// First-order bounds on max |C - fl(C)| for C = A * B, in the max norm (Higham, "Accuracy and
+// Stability of Numerical Algorithms", 2nd ed., section 23.2.2).
+struct ProductErrorBound {
+  double strassen;
+  double classical;
+};
+
+ProductErrorBound strassen_error_bound(const Matrix &a, const Matrix &b,
+                                       size_t crossover = STRASSEN_CROSSOVER);
+
+}  // namespace task
@@ -0,0 +1,224 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <iterator>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace task;
+
+namespace {
+
+thread_local bool inside_worker = false;
+
+std::shared_ptr<ThreadPool> &shared_pool() {
+  static std::shared_ptr<ThreadPool> pool;
+  return pool;
+}
+
+std::mutex &shared_pool_lock() {
+  static std::mutex lock;
+  return lock;
+}
+
+void pin_to_cpu(std::thread &thread, size_t index) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+    return;
+  }
+  size_t target = index % static_cast<size_t>(CPU_COUNT(&allowed));
+  for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+      cpu_set_t single;
+      CPU_ZERO(&single);
+      CPU_SET(cpu, &single);
+      pthread_setaffinity_np(thread.native_handle(), sizeof(single), &single);
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) : pending(0), stopping(false) {
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; ++i) {
+    this->queues.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 1; i < threads; ++i) {
+    this->workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    pin_to_cpu(this->workers.back(), i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(this->sleep_lock);
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for (auto &worker : this->workers) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::size() const {
+  return this->queues.size();
+}
+
+void ThreadPool::run(const Task &task) {
+  try {
+    (*task.job->body)(task.begin, task.end);
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(task.job->error_lock);
+    if (!task.job->error) {
+      task.job->error = std::current_exception();
+    }
+  }
+  task.job->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool ThreadPool::pop(size_t index, Task &task) {
+  Queue &queue = *this->queues[index];
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  task = queue.tasks.back();
+  queue.tasks.pop_back();
+  this->pending.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task &task) {
+  for (size_t offset = 1; offset < this->queues.size(); ++offset) {
+    Queue &queue = *this->queues[(thief + offset) % this->queues.size()];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+      this->pending.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Takes any queued task of `job`, wherever it was placed.
+bool ThreadPool::take(const Job &job, Task &task) {
+  for (auto &queue : this->queues) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    auto found = std::find_if(queue->tasks.rbegin(), queue->tasks.rend(),
+                              [&job](const Task &candidate) { return candidate.job == &job; });
+    if (found != queue->tasks.rend()) {
+      task = *found;
+      queue->tasks.erase(std::next(found).base());
+      this->pending.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+  inside_worker = true;
+  Task task{};
+  while (true) {
+    if (pop(index, task) || steal(index, task)) {
+      run(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(this->sleep_lock);
+    this->wake.wait(guard, [this]() {
+      return this->stopping || this->pending.load(std::memory_order_relaxed) > 0;
+    });
+    if (this->stopping) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, const Body &body) {
+  if (begin >= end) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  size_t chunks = (end - begin + grain - 1) / grain;
+  if (chunks == 1 || this->workers.empty() || inside_worker) {
+    for (size_t first = begin; first < end; first += grain) {
+      body(first, std::min(end, first + grain));
+    }
+    return;
+  }
+  Job job;
+  job.body = &body;
+  job.remaining.store(chunks, std::memory_order_relaxed);
+  size_t chunk = 0;
+  for (size_t first = begin; first < end; first += grain, ++chunk) {
+    Queue &queue = *this->queues[chunk % this->queues.size()];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.tasks.push_back(Task{&job, first, std::min(end, first + grain)});
+    this->pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  {
+    std::lock_guard<std::mutex> guard(this->sleep_lock);
+  }
+  this->wake.notify_all();
+  // The caller only helps with its own job: a task of another caller's job could reenter
+  // thread-local state the caller is still using, such as the gemm packing buffers. Nested
+  // parallel_for calls inside its tasks run serially, as they do on workers.
+  inside_worker = true;
+  Task task{};
+  while (job.remaining.load(std::memory_order_acquire) > 0) {
+    if (take(job, task)) {
+      run(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  inside_worker = false;
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+std::shared_ptr<ThreadPool> task::thread_pool() {
+  std::lock_guard<std::mutex> guard(shared_pool_lock());
+  auto &pool = shared_pool();
+  if (!pool) {
+    pool = std::make_shared<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+  }
+  return pool;
+}
+
+void task::set_num_threads(size_t threads) {
+  auto replacement = std::make_shared<ThreadPool>(threads);
+  {
+    std::lock_guard<std::mutex> guard(shared_pool_lock());
+    shared_pool().swap(replacement);
+  }
+  // replacement now holds the old pool, which is destroyed here unless still in use.
+}
+
+size_t task::num_threads() {
+  return thread_pool()->size();
+}
+
+void task::parallel_for(size_t begin, size_t end, size_t work, const ThreadPool::Body &body) {
+  if (begin >= end) {
+    return;
+  }
+  if (work < PARALLEL_THRESHOLD || inside_worker) {
+    body(begin, end);
+    return;
+  }
+  std::shared_ptr<ThreadPool> pool = thread_pool();
+  if (pool->size() == 1) {
+    body(begin, end);
+    return;
+  }
+  size_t per_index = std::max<size_t>(work / (end - begin), 1);
+  size_t grain = std::max<size_t>(PARALLEL_THRESHOLD / 4 / per_index, 1);
+  grain = std::max(grain, (end - begin + 4 * pool->size() - 1) / (4 * pool->size()));
+  pool->parallel_for(begin, end, grain, body);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace task {
+
+// Work below this many elements (or multiply-adds for gemm) runs on the calling thread.
+const size_t PARALLEL_THRESHOLD = 1 << 16;
+
+// Fixed-size pool of pinned workers with per-worker deques and work stealing.
+// parallel_for splits a range into chunks that depend only on the range and the grain,
+// so every chunk writes the same outputs whichever thread runs it.
+class ThreadPool {
+
+ public:
+
+  using Body = std::function<void(size_t, size_t)>;
+
+  explicit ThreadPool(size_t threads);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  size_t size() const;
+
+  // Calls body(chunk_begin, chunk_end) for consecutive chunks of at most grain indices
+  // covering [begin, end) and returns when all of them are done. The caller takes part in
+  // the work; calls made from inside a worker run serially.
+  void parallel_for(size_t begin, size_t end, size_t grain, const Body &body);
+
+ private:
+
+  struct Job {
+    const Body *body;
+    std::atomic<size_t> remaining;
+    std::mutex error_lock;
+    std::exception_ptr error;
+  };
+
+  struct Task {
+    Job *job;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  void worker_loop(size_t index);
+  bool pop(size_t index, Task &task);
+  bool steal(size_t thief, Task &task);
+  bool take(const Job &job, Task &task);
+  static void run(const Task &task);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> pending;
+  std::mutex sleep_lock;
+  std::condition_variable wake;
+  bool stopping;
+
+};
+
+// Process-wide pool used by Matrix operations, sized to the hardware by default. Callers
+// share ownership, so set_num_threads may run concurrently with operations: those already
+// holding the old pool finish on it, and it is destroyed once the last of them drops it.
+std::shared_ptr<ThreadPool> thread_pool();
+void set_num_threads(size_t threads);
+size_t num_threads();
+
+// Runs body over [begin, end) on the shared pool, or inline when work is below
+// PARALLEL_THRESHOLD or only one thread is configured.
+void parallel_for(size_t begin, size_t end, size_t work, const ThreadPool::Body &body);
+
+}  // namespace task
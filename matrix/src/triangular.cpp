@@ -0,0 +1,82 @@
+#include "triangular.h"
+#include <algorithm>
+#include "kernels.h"
+#include "thread_pool.h"
+
+using namespace task;
+
+namespace {
+
+// Element (i, j) of op(T) lives at data[i * row_step + j * col_step].
+struct TriangularOperand {
+  const double *data;
+  size_t row_step;
+  size_t col_step;
+
+  const double *at(size_t row, size_t col) const {
+    return this->data + row * this->row_step + col * this->col_step;
+  }
+};
+
+void solve_diagonal_block(const TriangularOperand &t, bool lower, bool unit_diagonal,
+                          size_t k0, size_t k_end, size_t r, double *b, size_t ldb) {
+  size_t kb = k_end - k0;
+  parallel_for(0, r, kb * kb * r, [&](size_t first, size_t last) {
+    size_t width = last - first;
+    for (size_t step = 0; step < kb; ++step) {
+      size_t k = lower ? k0 + step : k_end - 1 - step;
+      double *row = b + k * ldb + first;
+      if (!unit_diagonal) {
+        kernels::scale(row, 1.0 / *t.at(k, k), width);
+      }
+      size_t i_begin = lower ? k + 1 : k0;
+      size_t i_end = lower ? k_end : k;
+      for (size_t i = i_begin; i < i_end; ++i) {
+        kernels::axpy(b + i * ldb + first, -*t.at(i, k), row, width);
+      }
+    }
+  });
+}
+
+}  // namespace
+
+void task::trsm(Triangle uplo, GemmOp op, bool unit_diagonal, size_t n, size_t r,
+                const double *t, size_t ldt, double *b, size_t ldb) {
+  if (n == 0 || r == 0) {
+    return;
+  }
+  TriangularOperand operand = op == GemmOp::Transpose ? TriangularOperand{t, 1, ldt}
+                                                      : TriangularOperand{t, ldt, 1};
+  // A transposed upper triangle is solved as a lower one and vice versa.
+  bool lower = (uplo == Triangle::Lower) == (op == GemmOp::None);
+  size_t blocks = (n + TRSM_BLOCK - 1) / TRSM_BLOCK;
+  for (size_t step = 0; step < blocks; ++step) {
+    size_t block = lower ? step : blocks - 1 - step;
+    size_t k0 = block * TRSM_BLOCK;
+    size_t k_end = std::min(n, k0 + TRSM_BLOCK);
+    solve_diagonal_block(operand, lower, unit_diagonal, k0, k_end, r, b, ldb);
+    if (lower && k_end < n) {
+      gemm(op, GemmOp::None, n - k_end, r, k_end - k0, -1.0, operand.at(k_end, k0), ldt,
+           b + k0 * ldb, ldb, b + k_end * ldb, ldb);
+    } else if (!lower && k0 > 0) {
+      gemm(op, GemmOp::None, k0, r, k_end - k0, -1.0, operand.at(0, k0), ldt,
+           b + k0 * ldb, ldb, b, ldb);
+    }
+  }
+}
+
+Matrix task::column_matrix(const std::vector<double> &values) {
+  Matrix column(values.size(), 1);
+  for (size_t i = 0; i < values.size(); ++i) {
+    column[i][0] = values[i];
+  }
+  return column;
+}
+
+std::vector<double> task::column_values(const Matrix &column) {
+  std::vector<double> values(column.n_rows());
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = column[i][0];
+  }
+  return values;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "gemm.h"
+#include "matrix.h"
+
+namespace task {
+
+const size_t TRSM_BLOCK = 64;
+
+enum class Triangle {
+  Lower,
+  Upper
+};
+
+// Solves op(T) * X = B in place of B, where T is an n x n triangular matrix stored in the
+// given triangle (the other one is never read) and B is n x r. With unit_diagonal the
+// diagonal of T is taken as ones. Diagonal blocks are solved in parallel over columns of B
+// and the remaining rows are updated through gemm.
+void trsm(Triangle uplo, GemmOp op, bool unit_diagonal, size_t n, size_t r,
+          const double *t, size_t ldt, double *b, size_t ldb);
+
+// Right-hand side vectors of the factorizations travel as n x 1 matrices.
+Matrix column_matrix(const std::vector<double> &values);
+std::vector<double> column_values(const Matrix &column);
+
+}  // namespace task
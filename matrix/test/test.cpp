@@ -1,10 +1,25 @@
 #include <iostream>
 #include <string>
+#include <memory_resource>
 #include <random>
 #include <algorithm>
+#include <atomic>
 #include <sstream>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include "src/basic_matrix.h"
+#include "src/cholesky.h"
+#include "src/factorized_matrix.h"
+#include "src/lu.h"
 #include "src/matrix.h"
+#include "src/matrix_batch.h"
+#include "src/matrix_io.h"
+#include "src/qr.h"
+#include "src/sparse_matrix.h"
+#include "src/strassen.h"
 
 
 using task::Matrix;
@@ -208,6 +223,764 @@ int main(int argc, char** argv) {
     }
 
 
+    {
+        Matrix mat1;
+        std::stringstream stream("2 3\n+1 -2.5 3e2\n4 .5 -0\n");
+        stream >> mat1;
+        Matrix expected(2, 3);
+        expected[0][0] = 1., expected[0][1] = -2.5, expected[0][2] = 300.;
+        expected[1][0] = 4., expected[1][1] = .5, expected[1][2] = 0.;
+        ASSERT_TRUE_MSG(stream && mat1 == expected, "Stream input formats")
+
+        for (auto text : {"2 2\n1 2\n3 x\n", "2 2\n1 2\n3\n", "3 3\n1 2 3\n4 5 6 7\n"}) {
+            auto mat2 = RandomMatrix(4, 5);
+            auto copy = mat2;
+            std::stringstream malformed(text);
+            malformed >> mat2;
+            ASSERT_TRUE_MSG(malformed.fail(), "Malformed stream input")
+            ASSERT_TRUE_MSG(mat2 == copy, "Malformed stream input keeps the matrix")
+        }
+    }
+
+
+    REPEAT(10)
+    {
+        auto rows = RandomUInt(1, 60), cols = RandomUInt(1, 60);
+        auto mat1 = RandomMatrix(rows, cols);
+        auto mat2 = RandomMatrix(rows, cols);
+        auto mat3 = RandomMatrix(rows, cols);
+        double scalar = RandomDouble();
+
+        Matrix expected(rows, cols);
+        for (size_t row = 0; row < rows; ++row) {
+            for (size_t col = 0; col < cols; ++col) {
+                expected[row][col] = mat1[row][col] + scalar * mat2[row][col] - mat3[row][col];
+            }
+        }
+
+        Matrix res = mat1 + scalar * mat2 - mat3;
+        ASSERT_TRUE_MSG(res == expected, "Lazy expression")
+
+        res = -(mat3 - mat1) + mat2 * scalar;
+        ASSERT_TRUE_MSG(res == expected, "Lazy expression")
+
+        res = mat1;
+        res += scalar * mat2 - mat3;
+        ASSERT_TRUE_MSG(res == expected, "Lazy expression +=")
+
+        res -= -mat3 + mat1;
+        ASSERT_TRUE_MSG(res == scalar * mat2, "Lazy expression -=")
+
+        ASSERT_EXCEPTION_MSG(mat1 + mat2 - RandomMatrix(rows + 1, cols), task::SizeMismatchException,
+                             "Lazy expression")
+        ASSERT_EXCEPTION_MSG(res += mat1 - RandomMatrix(rows, cols + 1), task::SizeMismatchException,
+                             "Lazy expression +=")
+    }
+
+
+    REPEAT(10)
+    {
+        auto rows = RandomUInt(2, 60), cols = RandomUInt(2, 60);
+        auto mat1 = RandomMatrix(rows, cols);
+        auto copy = mat1;
+
+        size_t row = RandomUInt(0, rows - 1), col = RandomUInt(0, cols - 1);
+        auto row_view = mat1.row(row);
+        auto col_view = mat1.col(col);
+        ASSERT_TRUE_MSG(row_view.size() == cols && col_view.size() == rows, "Row / column view")
+        ASSERT_TRUE_MSG(row_view.to_vector() == mat1.getRow(row), "Row view")
+        ASSERT_TRUE_MSG(col_view.to_vector() == mat1.getColumn(col), "Column view")
+
+        row_view[col] = 1000.;
+        ASSERT_TRUE_MSG(mat1.get(row, col) == 1000. && col_view[row] == 1000., "Row / column view")
+        mat1.set(row, col, copy.get(row, col));
+
+        size_t top = RandomUInt(0, rows - 2), left = RandomUInt(0, cols - 2);
+        size_t height = RandomUInt(1, rows - top), width = RandomUInt(1, cols - left);
+        auto block = mat1.block(top, left, height, width);
+        auto other = RandomMatrix(height, width);
+        Matrix sum = block + other;
+        for (size_t i = 0; i < height; ++i) {
+            for (size_t j = 0; j < width; ++j) {
+                ASSERT_TRUE_MSG(fabs(sum[i][j] - (copy[top + i][left + j] + other[i][j])) < EPS,
+                                "Block view")
+            }
+        }
+
+        block = other;
+        block += other;
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                bool inside = i >= top && i < top + height && j >= left && j < left + width;
+                double value = inside ? 2. * other[i - top][j - left] : copy[i][j];
+                ASSERT_TRUE_MSG(fabs(mat1[i][j] - value) < EPS, "Block view assignment")
+            }
+        }
+
+        const Matrix &const_mat = mat1;
+        ASSERT_TRUE_MSG(const_mat.view() == mat1, "Matrix view")
+        ASSERT_EXCEPTION_MSG(mat1.row(rows), task::OutOfBoundsException, "Row view")
+        ASSERT_EXCEPTION_MSG(const_mat.col(cols), task::OutOfBoundsException, "Column view")
+        ASSERT_EXCEPTION_MSG(mat1.block(top, left, rows - top + 1, 1), task::OutOfBoundsException,
+                             "Block view")
+        ASSERT_EXCEPTION_MSG(block = RandomMatrix(height + 1, width), task::SizeMismatchException,
+                             "Block view assignment")
+    }
+
+
+    {
+        // Several threads calling into the pool at once: every caller must only help with its
+        // own job. A caller running another job's chunk that multiplies would repack the
+        // thread-local panel of its own product while the workers still read it.
+        auto mat1 = RandomMatrix(300, 300);
+        auto mat2 = RandomMatrix(300, 300);
+        auto small1 = RandomMatrix(60, 60);
+        auto small2 = RandomMatrix(60, 60);
+        task::set_num_threads(1);
+        Matrix expected = mat1 * mat2;
+        Matrix small_expected = small1 * small2;
+        task::set_num_threads(4);
+
+        std::atomic<bool> products_ok[3] = {{true}, {true}, {true}};
+        std::vector<std::thread> callers;
+        for (size_t i = 1; i < 3; ++i) {
+            callers.emplace_back([&, i]() {
+                REPEAT(5) {
+                    task::parallel_for(0, 64, size_t(1) << 30, [&](size_t first, size_t last) {
+                        for (size_t k = first; k < last; ++k) {
+                            if (!(small1 * small2 == small_expected)) {
+                                products_ok[i] = false;
+                            }
+                        }
+                    });
+                }
+            });
+        }
+        REPEAT(5) {
+            if (!(mat1 * mat2 == expected)) {
+                products_ok[0] = false;
+            }
+        }
+        for (auto &caller : callers) {
+            caller.join();
+        }
+        ASSERT_TRUE_MSG(products_ok[0] && products_ok[1] && products_ok[2], "Concurrent products")
+    }
+
+
+    {
+        auto mat1 = RandomMatrix(300, 200);
+        auto mat2 = RandomMatrix(200, 250);
+        task::set_num_threads(1);
+        Matrix serial = mat1 * mat2;
+        task::set_num_threads(4);
+        ASSERT_TRUE_MSG(task::num_threads() == 4, "set_num_threads()")
+        ASSERT_TRUE_MSG(mat1 * mat2 == serial, "Parallel product")
+
+        ASSERT_EXCEPTION_MSG(task::parallel_for(0, 1000, 1 << 20, [](size_t, size_t) {
+                                 throw std::runtime_error("chunk");
+                             }), std::runtime_error, "parallel_for() exception")
+
+        // Resizing the pool while another thread multiplies must not pull the pool from under it.
+        bool products_ok = true;
+        std::thread worker([&]() {
+            REPEAT(20) {
+                products_ok = products_ok && mat1 * mat2 == serial;
+            }
+        });
+        REPEAT(20) {
+            task::set_num_threads(2 + _iter % 3);
+        }
+        worker.join();
+        ASSERT_TRUE_MSG(products_ok, "set_num_threads() during a product")
+    }
+
+
+    REPEAT(10)
+    {
+        auto rows = RandomUInt(1, 150), cols = RandomUInt(1, 150);
+        auto mat1 = RandomMatrix(rows, cols);
+        Matrix expected(cols, rows);
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                expected[j][i] = mat1[i][j];
+            }
+        }
+        ASSERT_TRUE_MSG(mat1.transposed() == expected, "transposed()")
+        ASSERT_TRUE_MSG(mat1.transposed_view() == expected, "Transposed view")
+        ASSERT_TRUE_MSG(Matrix(mat1).transposed() == expected, "transposed() of a temporary")
+
+        auto mat2 = RandomMatrix(rows, RandomUInt(1, 50));
+        ASSERT_TRUE_MSG(mat1.transposed_view() * mat2 == expected * mat2, "Transposed view product")
+
+        auto copy = mat1;
+        copy.transpose();
+        ASSERT_TRUE_MSG(copy == expected, "transpose()")
+    }
+
+    {
+        // Assigning an expression that reads the target through another layout.
+        for (auto shape : {std::make_pair(3, 3), std::make_pair(2, 20), std::make_pair(37, 5)}) {
+            auto mat1 = RandomMatrix(shape.first, shape.second);
+            auto expected = mat1.transposed();
+            mat1 = mat1.transposed_view();
+            ASSERT_TRUE_MSG(mat1 == expected, "Self-assignment of a transposed view")
+
+            auto square = RandomMatrix(shape.second, shape.second);
+            expected = square + square.transposed();
+            square += square.transposed_view();
+            ASSERT_TRUE_MSG(square == expected, "Transposed view += itself")
+
+            expected = square.transposed() * 2. - square;
+            square = 2. * square.transposed_view() - square;
+            ASSERT_TRUE_MSG(square == expected, "Expression over a transposed view of itself")
+        }
+
+        auto mat1 = RandomMatrix(20, 20);
+        Matrix expected = Matrix(mat1.block(1, 2, 10, 5));
+        mat1 = mat1.block(1, 2, 10, 5);
+        ASSERT_TRUE_MSG(mat1 == expected, "Self-assignment of a block")
+
+        mat1 = RandomMatrix(6, 6);
+        expected = mat1.block(0, 0, 3, 6) + mat1.block(3, 0, 3, 6);
+        mat1.block(0, 0, 3, 6) += mat1.block(3, 0, 3, 6);
+        ASSERT_TRUE_MSG(mat1.block(0, 0, 3, 6) == expected, "Disjoint block update")
+    }
+
+
+    {
+        const std::string path = "matrix_test.tmat";
+        REPEAT(5)
+        {
+            auto mat1 = RandomMatrix(RandomUInt(1, 70), RandomUInt(1, 70));
+            task::save_binary(mat1, path);
+            ASSERT_TRUE_MSG(task::load_binary(path) == mat1, "Binary round trip")
+
+            task::MappedMatrix mapped(path);
+            ASSERT_TRUE_MSG(mapped.n_rows() == mat1.n_rows() && mapped.n_cols() == mat1.n_cols(),
+                            "Mapped matrix shape")
+            ASSERT_TRUE_MSG(mapped.verify() && mapped == mat1, "Mapped matrix")
+            ASSERT_TRUE_MSG(Matrix(mapped + mat1) == 2. * mat1, "Mapped matrix expression")
+        }
+
+        auto mat1 = RandomMatrix(10, 7);
+        {
+            task::MatrixWriter writer(path, 7);
+            writer.write_rows(mat1.block(0, 0, 4, 7));
+            for (size_t i = 4; i < 10; ++i) {
+                writer.write_row(mat1[i]);
+            }
+            ASSERT_EXCEPTION_MSG(writer.write_rows(mat1.block(0, 0, 2, 6)),
+                                 task::SizeMismatchException, "Writer row width")
+            writer.close();
+            ASSERT_EXCEPTION_MSG(writer.write_row(mat1[0]), task::MatrixFileException,
+                                 "Writing after close()")
+        }
+        ASSERT_TRUE_MSG(task::load_binary(path) == mat1, "Row-by-row writer")
+
+        std::FILE *file = std::fopen(path.c_str(), "r+b");
+        std::fseek(file, -1, SEEK_END);
+        int last = std::fgetc(file);
+        std::fseek(file, -1, SEEK_END);
+        std::fputc(last ^ 1, file);
+        std::fclose(file);
+        ASSERT_EXCEPTION_MSG(task::load_binary(path), task::MatrixFileException, "Corrupted payload")
+
+        file = std::fopen(path.c_str(), "wb");
+        std::fputs("not a matrix file", file);
+        std::fclose(file);
+        ASSERT_EXCEPTION_MSG(task::MappedMatrix{path}, task::MatrixFileException,
+                             "Truncated file")
+        std::remove(path.c_str());
+        ASSERT_EXCEPTION_MSG(task::load_binary(path), task::MatrixFileException, "Missing file")
+    }
+
+
+    {
+        // Fixed-size matrices are usable in constant expressions.
+        constexpr task::Matrix2i rotation{0, -1, 1, 0};
+        static_assert(rotation * rotation == -task::Matrix2i(), "Fixed-size product");
+        static_assert(rotation.det() == 1 && rotation.trace() == 0, "Fixed-size det / trace");
+        static_assert(rotation.transposed() == rotation * -1, "Fixed-size transposed()");
+
+        constexpr task::BasicMatrix<int64_t, 2, 3> wide{1, 2, 3, 4, 5, 6};
+        constexpr auto gram = wide * wide.transposed();
+        static_assert(gram == task::Matrix2l{14, 32, 32, 77}, "Fixed-size rectangular product");
+        static_assert(gram.det() == 54, "Fixed-size det");
+        static_assert(task::Matrix3l{2, 1, 0, 1, 3, 1, 0, 1, 4}.det() == 18, "Fixed-size 3x3 det");
+        static_assert(task::Matrix4l{0, 3, 1, 2, 2, 1, 0, 4, 1, 0, -2, 5, 3, -1, -1, 7}.det() == 26,
+                      "Fixed-size pivoting integer det");
+        static_assert(task::Matrix3d::zero() + task::Matrix3d() == task::Matrix3d(),
+                      "Fixed-size zero()");
+
+        auto mat1 = RandomMatrix(4, 4);
+        task::Matrix4d fixed(mat1);
+        ASSERT_TRUE_MSG(fabs(fixed.det() - mat1.det()) < EPS, "Fixed-size floating det")
+        ASSERT_TRUE_MSG((fixed * fixed).to_matrix() == mat1 * mat1, "Fixed-size product")
+        ASSERT_EXCEPTION_MSG(task::Matrix3d{mat1}, task::SizeMismatchException,
+                             "Fixed-size from Matrix")
+        ASSERT_EXCEPTION_MSG(task::Matrix2i({1, 2, 3}), task::SizeMismatchException,
+                             "Fixed-size initializer list")
+        ASSERT_EXCEPTION_MSG(fixed.get(4, 0), task::OutOfBoundsException, "Fixed-size get()")
+    }
+
+    REPEAT(10)
+    {
+        size_t n = RandomUInt(1, 7);
+        task::MatrixXl integral(n, n);
+        Matrix reference(n, n);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                integral[i][j] = static_cast<int64_t>(RandomUInt(0, 10)) - 5;
+                reference[i][j] = static_cast<double>(integral[i][j]);
+            }
+        }
+        ASSERT_TRUE_MSG(integral.det() == std::llround(reference.det()), "Exact integer det")
+        ASSERT_TRUE_MSG((integral * integral).to_matrix() == reference * reference,
+                        "Integer dynamic product")
+
+        auto rows = RandomUInt(1, 80), inner = RandomUInt(1, 80), cols = RandomUInt(1, 80);
+        auto mat1 = RandomMatrix(rows, inner);
+        auto mat2 = RandomMatrix(inner, cols);
+        task::MatrixXd left(mat1), right(mat2);
+        ASSERT_TRUE_MSG((left * right).to_matrix() == mat1 * mat2, "Dynamic gemm product")
+        ASSERT_TRUE_MSG((left.transposed() + left.transposed()).to_matrix() == 2. * mat1.transposed(),
+                        "Dynamic transposed()")
+        left *= right;
+        ASSERT_TRUE_MSG(left.n_rows() == rows && left.n_cols() == cols, "Dynamic *=")
+        ASSERT_EXCEPTION_MSG(right * task::MatrixXd(cols + 1, 2), task::SizeMismatchException,
+                             "Dynamic product")
+    }
+
+
+    REPEAT(10)
+    {
+        size_t n = RandomUInt(1, 150), crossover = RandomUInt(1, 32);
+        auto mat1 = RandomMatrix(n, n);
+        auto mat2 = RandomMatrix(n, n);
+        Matrix expected = mat1 * mat2;
+        Matrix product = task::strassen_multiply(mat1, mat2, crossover);
+        auto bound = task::strassen_error_bound(mat1, mat2, crossover);
+        double error = 0.;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                error = std::max(error, fabs(product[i][j] - expected[i][j]));
+            }
+        }
+        ASSERT_TRUE_MSG(error <= bound.strassen + bound.classical, "Strassen product")
+        ASSERT_TRUE_MSG(bound.classical <= bound.strassen, "Strassen error bound")
+
+        // Operands and result inside larger matrices keep their leading dimensions.
+        auto big = RandomMatrix(n + 3, n + 5);
+        Matrix result = big;
+        task::strassen(n, mat1.data(), mat1.leading_dim(), big.data() + 1, big.leading_dim(),
+                       result.data() + 2, result.leading_dim(), crossover);
+        ASSERT_TRUE_MSG(result.block(0, 2, n, n) == mat1 * big.block(0, 1, n, n),
+                        "Strassen on strided operands")
+        ASSERT_TRUE_MSG(result.block(n, 0, 3, n + 5) == big.block(n, 0, 3, n + 5) &&
+                        result.block(0, 0, n, 2) == big.block(0, 0, n, 2),
+                        "Strassen keeps elements outside the result")
+    }
+
+    ASSERT_EXCEPTION_MSG(task::strassen_multiply(RandomMatrix(4, 4), RandomMatrix(4, 5)),
+                         task::SizeMismatchException, "Strassen operand shapes")
+    ASSERT_EXCEPTION_MSG(task::strassen_multiply(RandomMatrix(4, 3), RandomMatrix(3, 4)),
+                         task::SizeMismatchException, "Strassen operand shapes")
+
+
+    {
+        Matrix zero = Matrix::zero(3, 5);
+        ASSERT_TRUE_MSG(zero.n_rows() == 3 && zero.n_cols() == 5 && zero == 0. * RandomMatrix(3, 5),
+                        "Matrix::zero()")
+    }
+
+    REPEAT(10)
+    {
+        auto rows = RandomUInt(1, 80), cols = RandomUInt(1, 80);
+        auto dense = Matrix::zero(rows, cols);
+        size_t nonzeros = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                if (RandomUInt(9) == 0) {
+                    dense[i][j] = RandomDouble();
+                    ++nonzeros;
+                }
+            }
+        }
+        auto layout = TossCoin() ? task::SparseLayout::CSR : task::SparseLayout::CSC;
+        task::SparseMatrix sparse(dense, layout);
+        ASSERT_TRUE_MSG(sparse.nnz() == nonzeros && sparse.layout() == layout, "Sparse from dense")
+        ASSERT_TRUE_MSG(sparse.to_dense() == dense, "Sparse to dense")
+        size_t row = RandomUInt(0, rows - 1), col = RandomUInt(0, cols - 1);
+        ASSERT_TRUE_MSG(sparse.get(row, col) == dense[row][col], "Sparse get()")
+        ASSERT_EXCEPTION_MSG(sparse.get(rows, 0), task::OutOfBoundsException, "Sparse get()")
+
+        auto other_layout = layout == task::SparseLayout::CSR ? task::SparseLayout::CSC
+                                                              : task::SparseLayout::CSR;
+        auto converted = sparse.to_layout(other_layout);
+        ASSERT_TRUE_MSG(converted.layout() == other_layout && converted.to_dense() == dense,
+                        "Sparse layout conversion")
+        ASSERT_TRUE_MSG(sparse.transposed().to_dense() == dense.transposed(), "Sparse transposed()")
+
+        std::vector<double> x(cols);
+        for (double &value : x) {
+            value = RandomDouble();
+        }
+        auto y = sparse * x;
+        Matrix column(cols, 1);
+        for (size_t j = 0; j < cols; ++j) {
+            column[j][0] = x[j];
+        }
+        Matrix expected = dense * column;
+        bool vector_ok = y.size() == rows;
+        for (size_t i = 0; vector_ok && i < rows; ++i) {
+            vector_ok = fabs(y[i] - expected[i][0]) < EPS;
+        }
+        ASSERT_TRUE_MSG(vector_ok, "Sparse matrix-vector product")
+        auto mat1 = RandomMatrix(cols, RandomUInt(1, 30));
+        ASSERT_TRUE_MSG(sparse * mat1 == dense * mat1, "Sparse matrix-matrix product")
+        ASSERT_EXCEPTION_MSG(sparse * RandomMatrix(cols + 1, 2), task::SizeMismatchException,
+                             "Sparse product")
+
+        task::SparseMatrix sum = sparse + converted;
+        ASSERT_TRUE_MSG(sum.layout() == layout && sum.to_dense() == 2. * dense, "Sparse sum")
+        ASSERT_TRUE_MSG((sparse - converted).nnz() == 0, "Sparse difference cancels")
+    }
+
+    {
+        auto entries = std::vector<task::SparseEntry>{{1, 2, 1.}, {0, 0, 2.}, {1, 2, 3.},
+                                                      {2, 1, 4.}, {2, 1, -4.}};
+        auto sparse = task::SparseMatrix::from_entries(3, 3, entries, task::SparseLayout::CSC);
+        ASSERT_TRUE_MSG(sparse.nnz() == 2 && sparse.get(1, 2) == 4. && sparse.get(0, 0) == 2.,
+                        "Sparse from entries")
+        entries.push_back({3, 0, 1.});
+        ASSERT_EXCEPTION_MSG(task::SparseMatrix::from_entries(3, 3, entries),
+                             task::OutOfBoundsException, "Sparse entry outside the shape")
+
+        Matrix dense(2, 2);
+        dense[0][1] = 1e-3;
+        dense[1][0] = NAN;
+        task::SparseMatrix tolerant(dense, task::SparseLayout::CSR, 1e-2);
+        ASSERT_TRUE_MSG(tolerant.nnz() == 3 && std::isnan(tolerant.get(1, 0)),
+                        "Sparse tolerance keeps NaN")
+    }
+
+
+    REPEAT(5)
+    {
+        size_t n = RandomUInt(1, 200);
+        auto identity = Matrix(n, n);
+        auto mat1 = RandomMatrix(n, n) + 10. * n * identity;
+        auto rhs = RandomMatrix(n, RandomUInt(1, 20));
+
+        task::LU lu = mat1.lu();
+        ASSERT_TRUE_MSG(!lu.is_singular() && lu.size() == n, "LU")
+        // Determinants of the larger orders overflow.
+        if (n <= 40) {
+            ASSERT_TRUE_MSG(fabs(lu.det() / mat1.transposed().det() - 1.) < EPS, "LU det")
+        }
+        ASSERT_TRUE_MSG(mat1 * lu.solve(rhs) == rhs && mat1 * mat1.solve(rhs) == rhs, "LU solve")
+        ASSERT_TRUE_MSG(mat1 * mat1.inverse() == identity, "Inverse")
+        std::vector<double> column = rhs.getColumn(0);
+        auto x = mat1.solve(column);
+        Matrix x_column(n, 1);
+        for (size_t i = 0; i < n; ++i) {
+            x_column[i][0] = x[i];
+        }
+        ASSERT_TRUE_MSG(mat1 * x_column == rhs.block(0, 0, n, 1), "LU vector solve")
+
+        Matrix spd = mat1 * mat1.transposed_view() + identity;
+        task::Cholesky cholesky = spd.cholesky();
+        const Matrix &l = cholesky.factor();
+        bool lower = true;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                lower = lower && l[i][j] == 0.;
+            }
+        }
+        ASSERT_TRUE_MSG(lower && l * l.transposed_view() == spd, "Cholesky factor")
+        ASSERT_TRUE_MSG(spd * cholesky.solve(rhs) == rhs, "Cholesky solve")
+        ASSERT_TRUE_MSG(spd * cholesky.inverse() == identity, "Cholesky inverse")
+        if (n <= 40) {
+            ASSERT_TRUE_MSG(fabs(cholesky.det() / spd.det() - 1.) < EPS, "Cholesky det")
+        }
+
+        size_t m = n + RandomUInt(0, 50);
+        auto tall = RandomMatrix(m, n);
+        task::QR qr = tall.qr();
+        Matrix q = qr.q(), r = qr.r();
+        bool upper = q.n_rows() == m && q.n_cols() == n && r.n_rows() == n && r.n_cols() == n;
+        for (size_t i = 0; upper && i < n; ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                upper = upper && r[i][j] == 0.;
+            }
+        }
+        ASSERT_TRUE_MSG(upper && q * r == tall, "QR factors")
+        ASSERT_TRUE_MSG(q.transposed_view() * q == identity, "QR orthonormal columns")
+        auto solution = RandomMatrix(n, 3);
+        ASSERT_TRUE_MSG(qr.solve(tall * solution) == solution, "QR least squares")
+    }
+
+    {
+        auto singular = RandomMatrix(5, 5);
+        for (size_t j = 0; j < 5; ++j) {
+            singular[3][j] = singular[1][j];
+        }
+        ASSERT_TRUE_MSG(singular.lu().is_singular(), "Singular LU")
+        ASSERT_EXCEPTION_MSG(singular.solve(RandomMatrix(5, 1)), task::SingularMatrixException,
+                             "Singular solve")
+        ASSERT_EXCEPTION_MSG(singular.inverse(), task::SingularMatrixException, "Singular inverse")
+        ASSERT_EXCEPTION_MSG(task::Cholesky(-1. * Matrix(4, 4)), task::NotPositiveDefiniteException,
+                             "Cholesky of a negative definite matrix")
+        ASSERT_EXCEPTION_MSG(task::QR(RandomMatrix(3, 4)), task::SizeMismatchException, "Wide QR")
+        ASSERT_EXCEPTION_MSG(RandomMatrix(3, 4).lu(), task::SizeMismatchException, "Non-square LU")
+    }
+
+
+    REPEAT(20)
+    {
+        auto rows = RandomUInt(1, 40), cols = RandomUInt(1, 40);
+        auto mat1 = RandomMatrix(rows, cols);
+        std::vector<double> elements;
+        for (size_t i = 0; i < rows; ++i) {
+            auto row = mat1.getRow(i);
+            elements.insert(elements.end(), row.begin(), row.end());
+        }
+        auto new_rows = RandomUInt(0, 40), new_cols = TossCoin() ? cols : RandomUInt(1, 40);
+        mat1.resize(new_rows, new_cols);
+        bool kept = mat1.n_rows() == new_rows && mat1.n_cols() == new_cols;
+        for (size_t k = 0; kept && k < new_rows * new_cols; ++k) {
+            double expected = k < elements.size() ? elements[k] : 0.;
+            kept = mat1[k / new_cols][k % new_cols] == expected;
+        }
+        ASSERT_TRUE_MSG(kept, "resize() keeps the element order")
+        ASSERT_TRUE_MSG(mat1.capacity() >= new_rows * Matrix::aligned_stride(new_cols),
+                        "resize() capacity")
+    }
+
+    {
+        Matrix mat1(1, 30);
+        mat1.reserve(100, 30);
+        size_t capacity = mat1.capacity();
+        const double *data = mat1.data();
+        ASSERT_TRUE_MSG(capacity >= 100 * Matrix::aligned_stride(30), "reserve()")
+        ASSERT_TRUE_MSG(mat1.n_rows() == 1 && mat1.get(0, 0) == 1., "reserve() keeps the shape")
+        for (size_t rows = 2; rows <= 100; ++rows) {
+            mat1.resize(rows, 30);
+        }
+        ASSERT_TRUE_MSG(mat1.data() == data && mat1.capacity() == capacity,
+                        "Row growth within capacity keeps the buffer")
+        mat1.resize(3, 30);
+        mat1.shrink_to_fit();
+        ASSERT_TRUE_MSG(mat1.capacity() == 3 * Matrix::aligned_stride(30) && mat1.get(0, 0) == 1.,
+                        "shrink_to_fit()")
+
+        size_t grown = 0;
+        for (size_t rows = 4; rows <= 1000; ++rows) {
+            capacity = mat1.capacity();
+            mat1.resize(rows, 30);
+            grown += mat1.capacity() != capacity;
+        }
+        ASSERT_TRUE_MSG(grown <= 10, "Row growth is amortized")
+    }
+
+
+    REPEAT(10)
+    {
+        size_t count = RandomUInt(1, 3 * task::BATCH_LANES);
+        auto rows = RandomUInt(1, 6), inner = RandomUInt(1, 6), cols = RandomUInt(1, 6);
+        std::vector<Matrix> left, right, square;
+        for (size_t index = 0; index < count; ++index) {
+            left.push_back(RandomMatrix(rows, inner));
+            right.push_back(RandomMatrix(inner, cols));
+            square.push_back(RandomMatrix(rows, rows));
+        }
+        task::MatrixBatch left_batch(left), right_batch(right), square_batch(square);
+        ASSERT_TRUE_MSG(left_batch.size() == count && left_batch.n_rows() == rows &&
+                        left_batch.n_cols() == inner, "Batch shape")
+        ASSERT_TRUE_MSG(left_batch.n_tiles() == (count + task::BATCH_LANES - 1) / task::BATCH_LANES,
+                        "Batch tiles")
+
+        task::MatrixBatch product = left_batch * right_batch;
+        task::MatrixBatch transposed = left_batch.transposed();
+        auto dets = square_batch.det();
+        auto traces = square_batch.trace();
+        bool batch_ok = dets.size() == count && traces.size() == count;
+        for (size_t index = 0; batch_ok && index < count; ++index) {
+            batch_ok = product.matrix(index) == left[index] * right[index] &&
+                       transposed.matrix(index) == left[index].transposed() &&
+                       fabs(dets[index] - square[index].det()) < EPS &&
+                       fabs(traces[index] - square[index].trace()) < EPS;
+        }
+        ASSERT_TRUE_MSG(batch_ok, "Batched products, transposes, determinants and traces")
+
+        product.multiply(square_batch, left_batch);
+        ASSERT_TRUE_MSG(product.n_rows() == rows && product.n_cols() == inner &&
+                        product.matrix(count - 1) == square[count - 1] * left[count - 1],
+                        "Batched multiply() into an existing batch")
+        square_batch.multiply(square_batch, square_batch);
+        ASSERT_TRUE_MSG(square_batch.matrix(0) == square[0] * square[0], "Batched multiply() in place")
+
+        task::MatrixBatch zeros(count, rows, cols);
+        ASSERT_TRUE_MSG(zeros.matrix(count - 1) == Matrix::zero(rows, cols), "Zero batch")
+        zeros.set(0, rows - 1, cols - 1, 5.);
+        ASSERT_TRUE_MSG(zeros.get(0, rows - 1, cols - 1) == 5., "Batch set()")
+        ASSERT_EXCEPTION_MSG(zeros.get(count, 0, 0), task::OutOfBoundsException, "Batch get()")
+        ASSERT_EXCEPTION_MSG(left_batch * task::MatrixBatch(count, inner + 1, 2),
+                             task::SizeMismatchException, "Batched product shapes")
+        ASSERT_EXCEPTION_MSG(left_batch * task::MatrixBatch(count + 1, inner, 2),
+                             task::SizeMismatchException, "Batched product sizes")
+        left.push_back(RandomMatrix(rows + 1, inner));
+        ASSERT_EXCEPTION_MSG(task::MatrixBatch{left}, task::SizeMismatchException,
+                             "Batch of mixed shapes")
+    }
+
+
+    {
+        struct CountingResource : std::pmr::memory_resource {
+            size_t allocations = 0;
+            size_t live = 0;
+
+            void *do_allocate(size_t bytes, size_t alignment) override {
+                ++allocations;
+                ++live;
+                return task::aligned_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *pointer, size_t bytes, size_t alignment) override {
+                --live;
+                task::aligned_resource()->deallocate(pointer, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+                return this == &other;
+            }
+        };
+
+        CountingResource counting, other;
+        {
+            auto source = RandomMatrix(17, 9);
+            Matrix mat1(17, 9, &counting);
+            ASSERT_TRUE_MSG(mat1.resource() == &counting && counting.allocations == 1,
+                            "Matrix on a resource")
+            ASSERT_TRUE_MSG(reinterpret_cast<uintptr_t>(mat1.data()) % task::MATRIX_ALIGNMENT == 0,
+                            "Resource buffers are aligned")
+
+            mat1 = source;
+            mat1 = source + source;
+            mat1 = Matrix(source);
+            ASSERT_TRUE_MSG(mat1.resource() == &counting && mat1 == 2. * source - source,
+                            "Assignment keeps the target resource")
+            Matrix copy(mat1);
+            ASSERT_TRUE_MSG(copy.resource() == task::default_matrix_resource(),
+                            "Copies use the default resource")
+            Matrix moved(std::move(mat1));
+            ASSERT_TRUE_MSG(moved.resource() == &counting && moved == source,
+                            "Moves take the resource")
+
+            Matrix foreign(2, 2, &other);
+            foreign = std::move(moved);
+            ASSERT_TRUE_MSG(foreign.resource() == &other && foreign == source,
+                            "Moves across resources copy")
+
+            auto previous = task::set_default_matrix_resource(&counting);
+            size_t allocations = counting.allocations;
+            Matrix defaulted(3, 3);
+            ASSERT_TRUE_MSG(defaulted.resource() == &counting && counting.allocations > allocations,
+                            "set_default_matrix_resource()")
+            ASSERT_TRUE_MSG(task::set_default_matrix_resource(nullptr) == &counting &&
+                            task::default_matrix_resource() == task::aligned_resource(),
+                            "Restoring the default resource")
+            task::set_default_matrix_resource(previous);
+        }
+        ASSERT_TRUE_MSG(counting.live == 0 && other.live == 0, "Resource buffers are released")
+
+        std::pmr::memory_resource *scratch = task::scratch_resource();
+        void *first = scratch->allocate(1000 * sizeof(double), task::MATRIX_ALIGNMENT);
+        scratch->deallocate(first, 1000 * sizeof(double), task::MATRIX_ALIGNMENT);
+        void *second = scratch->allocate(1000 * sizeof(double), task::MATRIX_ALIGNMENT);
+        ASSERT_TRUE_MSG(first == second, "Scratch blocks are reused")
+        scratch->deallocate(second, 1000 * sizeof(double), task::MATRIX_ALIGNMENT);
+    }
+
+
+    REPEAT(5)
+    {
+        size_t n = RandomUInt(2, 30);
+        Matrix reference = RandomMatrix(n, n) + 10. * n * Matrix(n, n);
+        task::FactorizedMatrix factorized(reference);
+        bool updates_ok = true;
+        for (size_t step = 0; step < 3 * n; ++step) {
+            std::vector<double> u(n), v(n);
+            for (size_t i = 0; i < n; ++i) {
+                u[i] = RandomDouble() / 10.;
+                v[i] = RandomDouble() / 10.;
+            }
+            size_t index = RandomUInt(0, n - 1);
+            switch (RandomUInt(2)) {
+                case 0:
+                    factorized.rank_one_update(u, v);
+                    for (size_t i = 0; i < n; ++i) {
+                        for (size_t j = 0; j < n; ++j) {
+                            reference[i][j] += u[i] * v[j];
+                        }
+                    }
+                    break;
+                case 1:
+                    u[index] = 10. * n;
+                    factorized.replace_row(index, u);
+                    for (size_t j = 0; j < n; ++j) {
+                        reference[index][j] = u[j];
+                    }
+                    break;
+                default:
+                    v[index] = 10. * n;
+                    factorized.replace_column(index, v);
+                    for (size_t i = 0; i < n; ++i) {
+                        reference[i][index] = v[i];
+                    }
+            }
+            auto rhs = RandomMatrix(n, 2);
+            updates_ok = updates_ok && factorized.matrix() == reference &&
+                         factorized.pending_updates() <= n &&
+                         fabs(factorized.det() / reference.det() - 1.) < EPS &&
+                         reference * factorized.solve(rhs) == rhs;
+        }
+        ASSERT_TRUE_MSG(updates_ok, "Factorized matrix updates")
+
+        std::vector<double> b = reference.getColumn(0);
+        auto x = factorized.solve(b);
+        ASSERT_TRUE_MSG(fabs(x[0] - 1.) < EPS && fabs(x[n - 1]) < EPS, "Factorized vector solve")
+        factorized.refactorize();
+        ASSERT_TRUE_MSG(factorized.pending_updates() == 0 &&
+                        fabs(factorized.det() / reference.det() - 1.) < EPS, "refactorize()")
+
+        // A singular intermediate matrix, and a return from it.
+        std::vector<double> saved = reference.getRow(n - 1);
+        factorized.replace_row(n - 1, reference.getRow(0));
+        ASSERT_TRUE_MSG(fabs(factorized.det()) < EPS, "Singular factorized matrix")
+        ASSERT_EXCEPTION_MSG(factorized.solve(b), task::SingularMatrixException,
+                             "Singular factorized solve")
+        factorized.replace_row(n - 1, saved);
+        ASSERT_TRUE_MSG(reference * factorized.solve(reference) == reference,
+                        "Factorized matrix after a singular update")
+
+        // A pivot below EPS counts as singular, as it does for LU::is_singular.
+        Matrix nearly_singular(n, n);
+        nearly_singular[n / 2][n / 2] = task::EPS / 10;
+        ASSERT_TRUE_MSG(nearly_singular.lu().is_singular(), "Nearly singular LU")
+        ASSERT_EXCEPTION_MSG(task::FactorizedMatrix(nearly_singular).solve(b),
+                             task::SingularMatrixException, "Nearly singular factorized solve")
+
+        ASSERT_EXCEPTION_MSG(factorized.replace_row(n, saved), task::OutOfBoundsException,
+                             "Factorized row index")
+        ASSERT_EXCEPTION_MSG(factorized.rank_one_update(std::vector<double>(n + 1), saved),
+                             task::SizeMismatchException, "Factorized update size")
+        ASSERT_EXCEPTION_MSG(task::FactorizedMatrix(RandomMatrix(n, n + 1)),
+                             task::SizeMismatchException, "Non-square factorized matrix")
+    }
+
+
     const int STRESS_TEST_COUNT = argc > 1 ? std::stoi(argv[1]) : 0;
 
     REPEAT(STRESS_TEST_COUNT)
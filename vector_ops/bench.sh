@@ -0,0 +1,8 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -O2 -pthread -I./ bench/bench.cpp -o vector_ops_bench
+./vector_ops_bench "$@"
+
+rm vector_ops_bench
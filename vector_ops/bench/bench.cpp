@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "src/vector_ops.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <class T>
+void do_not_optimize(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Timing state of one run; only the iterations of the keep_running() loop are measured,
+// so setup done before the loop is free.
+class State {
+
+ public:
+
+  State(size_t size, size_t iterations) : size(size), iterations(iterations) {}
+
+  bool keep_running() {
+    if (this->done == 0) {
+      this->start = Clock::now();
+    }
+    if (this->done == this->iterations) {
+      this->elapsed = std::chrono::duration<double>(Clock::now() - this->start).count();
+      return false;
+    }
+    ++this->done;
+    return true;
+  }
+
+  // Memory traffic of one operation, used for the bytes/s column.
+  void set_bytes(double bytes) {
+    this->bytes = bytes;
+  }
+
+  size_t size;
+  size_t iterations;
+  size_t done = 0;
+  double elapsed = 0;
+  double bytes = 0;
+
+ private:
+
+  Clock::time_point start;
+
+};
+
+struct Benchmark {
+  std::string name;
+  std::function<void(State &)> body;
+};
+
+struct Options {
+  double min_time = 0.2;
+  size_t max_size = 100000000;
+  std::string filter;
+  std::string output;
+};
+
+std::vector<double> random_vector(size_t size, unsigned seed) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> distribution(-10., 10.);
+  std::vector<double> result(size);
+  for (double &value : result) {
+    value = distribution(generator);
+  }
+  return result;
+}
+
+std::vector<int> random_mask(size_t size, unsigned seed) {
+  std::mt19937 generator(seed);
+  std::vector<int> result(size);
+  for (int &value : result) {
+    value = generator() & 1;
+  }
+  return result;
+}
+
+double vector_bytes(size_t size, double count) {
+  return count * size * sizeof(double);
+}
+
+// The scalar loop operator* used before the SIMD kernels, kept as the baseline.
+double dot_scalar(const std::vector<double> &left, const std::vector<double> &right) {
+  double result = 0;
+  for (size_t i = 0; i < right.size(); ++i) {
+    result += left[i] * right[i];
+  }
+  return result;
+}
+
+Benchmark dot_benchmark(const std::string &name, task::Summation summation) {
+  return {name, [summation](State &state) {
+            std::vector<double> a = random_vector(state.size, 1);
+            std::vector<double> b = random_vector(state.size, 2);
+            while (state.keep_running()) {
+              double d = task::dot(a, b, summation);
+              do_not_optimize(d);
+            }
+            state.set_bytes(vector_bytes(state.size, 2));
+          }};
+}
+
+std::vector<Benchmark> benchmarks() {
+  return {
+      {"dot_scalar", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        while (state.keep_running()) {
+          double d = dot_scalar(a, b);
+          do_not_optimize(d);
+        }
+        state.set_bytes(vector_bytes(state.size, 2));
+      }},
+      dot_benchmark("dot", task::Summation::Fast),
+      dot_benchmark("dot_compensated", task::Summation::Compensated),
+      dot_benchmark("dot_pairwise", task::Summation::Pairwise),
+      {"dot_parallel", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        while (state.keep_running()) {
+          double d = task::parallel::dot(a, b);
+          do_not_optimize(d);
+        }
+        state.set_bytes(vector_bytes(state.size, 2));
+      }},
+      {"add", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        while (state.keep_running()) {
+          std::vector<double> c = task::operator+(a, b);
+          do_not_optimize(c);
+        }
+        state.set_bytes(vector_bytes(state.size, 3));
+      }},
+      {"add_parallel", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        while (state.keep_running()) {
+          std::vector<double> c = task::parallel::add(a, b);
+          do_not_optimize(c);
+        }
+        state.set_bytes(vector_bytes(state.size, 3));
+      }},
+      {"sub", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        while (state.keep_running()) {
+          std::vector<double> c = task::operator-(a, b);
+          do_not_optimize(c);
+        }
+        state.set_bytes(vector_bytes(state.size, 3));
+      }},
+      {"negate", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        while (state.keep_running()) {
+          std::vector<double> c = task::operator-(a);
+          do_not_optimize(c);
+        }
+        state.set_bytes(vector_bytes(state.size, 2));
+      }},
+      {"mask_or", [](State &state) {
+        std::vector<int> a = random_mask(state.size, 1);
+        std::vector<int> b = random_mask(state.size, 2);
+        while (state.keep_running()) {
+          std::vector<int> c = task::operator|(a, b);
+          do_not_optimize(c);
+        }
+        state.set_bytes(3. * state.size * sizeof(int));
+      }},
+      {"bitset_or", [](State &state) {
+        task::Bitset a(random_mask(state.size, 1));
+        task::Bitset b(random_mask(state.size, 2));
+        while (state.keep_running()) {
+          a |= b;
+          do_not_optimize(a);
+        }
+        state.set_bytes(3. * a.word_size() * sizeof(uint32_t));
+      }},
+      {"bitset_count", [](State &state) {
+        task::Bitset a(random_mask(state.size, 1));
+        while (state.keep_running()) {
+          size_t count = a.count();
+          do_not_optimize(count);
+        }
+        state.set_bytes(1. * a.word_size() * sizeof(uint32_t));
+      }},
+      {"add_sub_eager", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        std::vector<double> c = random_vector(state.size, 3);
+        std::vector<double> d;
+        while (state.keep_running()) {
+          d = task::operator-(task::operator+(a, b), c);
+          do_not_optimize(d);
+        }
+        state.set_bytes(vector_bytes(state.size, 4));
+      }},
+      {"add_sub_lazy", [](State &state) {
+        std::vector<double> a = random_vector(state.size, 1);
+        std::vector<double> b = random_vector(state.size, 2);
+        std::vector<double> c = random_vector(state.size, 3);
+        std::vector<double> d;
+        while (state.keep_running()) {
+          task::assign(d, task::lazy(a) + b - c);
+          do_not_optimize(d);
+        }
+        state.set_bytes(vector_bytes(state.size, 4));
+      }},
+  };
+}
+
+// Runs once to estimate the cost, then repeats until the measured loop lasts min_time.
+State measure(const Benchmark &benchmark, size_t size, double min_time) {
+  State probe(size, 1);
+  benchmark.body(probe);
+  if (probe.elapsed >= min_time) {
+    return probe;
+  }
+  double estimate = min_time / std::max(probe.elapsed, 1e-9);
+  State state(size, static_cast<size_t>(std::min(estimate, 1e9)) + 1);
+  benchmark.body(state);
+  return state;
+}
+
+// 16, 256, ... up to max_size, which is always measured itself.
+std::vector<size_t> sizes(size_t max_size) {
+  std::vector<size_t> result;
+  for (size_t size = 16; size <= max_size; size *= 16) {
+    result.push_back(size);
+  }
+  if (result.empty() || result.back() != max_size) {
+    result.push_back(max_size);
+  }
+  return result;
+}
+
+const char *simd_name() {
+  switch (task::simd_level()) {
+    case task::SimdLevel::AVX512:
+      return "avx512";
+    case task::SimdLevel::AVX2:
+      return "avx2";
+    default:
+      return "sse2";
+  }
+}
+
+void write_result(std::ostream &output, const std::string &name, const State &state, bool last) {
+  double seconds = state.elapsed / state.iterations;
+  output << "    {\"name\": \"" << name << "/" << state.size << "\", "
+         << "\"size\": " << state.size << ", "
+         << "\"iterations\": " << state.iterations << ", "
+         << "\"real_time_ns\": " << seconds * 1e9 << ", "
+         << "\"bytes_per_second\": " << state.bytes / seconds << "}" << (last ? "\n" : ",\n");
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    auto value = [&argument](const std::string &flag) {
+      return argument.substr(flag.size());
+    };
+    if (argument.rfind("--min-time=", 0) == 0) {
+      options.min_time = std::stod(value("--min-time="));
+    } else if (argument.rfind("--max-size=", 0) == 0) {
+      options.max_size = std::stoul(value("--max-size="));
+    } else if (argument.rfind("--filter=", 0) == 0) {
+      options.filter = value("--filter=");
+    } else if (argument.rfind("--out=", 0) == 0) {
+      options.output = value("--out=");
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--min-time=SECONDS] [--max-size=N] [--filter=SUBSTRING] [--out=FILE]\n";
+      std::exit(2);
+    }
+  }
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options = parse_options(argc, argv);
+  std::ostringstream results;
+  std::vector<std::pair<std::string, State>> rows;
+  for (const Benchmark &benchmark : benchmarks()) {
+    if (benchmark.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    for (size_t size : sizes(options.max_size)) {
+      State state = measure(benchmark, size, options.min_time);
+      std::cerr << benchmark.name << "/" << size << ": " << state.elapsed / state.iterations * 1e9
+                << " ns\n";
+      rows.emplace_back(benchmark.name, state);
+    }
+  }
+  std::time_t now = std::time(nullptr);
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  results << "{\n  \"context\": {\"date\": \"" << date << "\", "
+          << "\"simd\": \"" << simd_name() << "\", "
+          << "\"threads\": " << task::parallel::num_threads() << ", "
+          << "\"min_time\": " << options.min_time << "},\n"
+          << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    write_result(results, rows[i].first, rows[i].second, i + 1 == rows.size());
+  }
+  results << "  ]\n}\n";
+  if (options.output.empty()) {
+    std::cout << results.str();
+  } else {
+    std::ofstream(options.output) << results.str();
+  }
+  return 0;
+}
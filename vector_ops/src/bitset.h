@@ -0,0 +1,175 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vector_kernels.h"
+
+namespace task {
+
+static_assert(std::is_same<uint32_t, unsigned int>::value,
+              "Bitset words must be the unsigned counterpart of int");
+
+// Packed boolean mask: bit i stands for element i of a std::vector<int> mask being non-zero,
+// at 1/32 of its memory. The words live in a std::vector<int>, so a mask moved in is packed
+// inside its own buffer and to_ints() on an rvalue unpacks inside it again. Bits past size()
+// in the last word are always zero. Binary operations throw std::invalid_argument on bitsets
+// of different sizes.
+class Bitset {
+
+ public:
+
+  Bitset() = default;
+
+  explicit Bitset(size_t size, bool value = false)
+      : length(size), storage(word_count(size), value ? ~0 : 0) {
+    this->clear_tail();
+  }
+
+  explicit Bitset(const std::vector<int> &mask)
+      : length(mask.size()), storage(word_count(mask.size())) {
+    kernels::pack(this->words(), mask.data(), mask.size());
+  }
+
+  // Takes over mask's buffer and packs it in place; only the packed words are kept afterwards.
+  explicit Bitset(std::vector<int> &&mask) : length(mask.size()), storage(std::move(mask)) {
+    kernels::pack(this->words(), this->storage.data(), this->length);
+    this->storage.resize(word_count(this->length));
+    this->storage.shrink_to_fit();
+  }
+
+  size_t size() const {
+    return this->length;
+  }
+
+  size_t word_size() const {
+    return this->storage.size();
+  }
+
+  uint32_t *words() {
+    return reinterpret_cast<uint32_t *>(this->storage.data());
+  }
+
+  const uint32_t *words() const {
+    return reinterpret_cast<const uint32_t *>(this->storage.data());
+  }
+
+  bool test(size_t i) const {
+    return *(this->words() + i / 32) >> (i % 32) & 1;
+  }
+
+  void set(size_t i, bool value = true) {
+    uint32_t bit = uint32_t(1) << (i % 32);
+    uint32_t &word = *(this->words() + i / 32);
+    word = value ? word | bit : word & ~bit;
+  }
+
+  void reset(size_t i) {
+    this->set(i, false);
+  }
+
+  // Number of set bits.
+  size_t count() const {
+    return kernels::popcount(this->words(), this->word_size());
+  }
+
+  Bitset &operator|=(const Bitset &other) {
+    this->check_size(other);
+    kernels::bit_or(this->words(), this->words(), other.words(), this->word_size());
+    return *this;
+  }
+
+  Bitset &operator&=(const Bitset &other) {
+    this->check_size(other);
+    kernels::bit_and(this->words(), this->words(), other.words(), this->word_size());
+    return *this;
+  }
+
+  Bitset &operator^=(const Bitset &other) {
+    this->check_size(other);
+    kernels::bit_xor(this->words(), this->words(), other.words(), this->word_size());
+    return *this;
+  }
+
+  // this &= ~other
+  Bitset &and_not(const Bitset &other) {
+    this->check_size(other);
+    kernels::bit_andnot(this->words(), this->words(), other.words(), this->word_size());
+    return *this;
+  }
+
+  // 0/1 ints, the form taken by operator| and operator& on std::vector<int>.
+  std::vector<int> to_ints() const & {
+    std::vector<int> result(this->length);
+    for (size_t i = 0; i < this->length; ++i) {
+      result[i] = this->test(i);
+    }
+    return result;
+  }
+
+  // Unpacks inside this bitset's own buffer, back to front: slot i still holds word i when it
+  // is overwritten, and that word's bits 32i and up are unpacked by then.
+  std::vector<int> to_ints() && {
+    this->storage.resize(this->length);
+    for (size_t i = this->length; i-- > 0;) {
+      uint32_t word = static_cast<uint32_t>(this->storage[i / 32]);
+      this->storage[i] = word >> (i % 32) & 1;
+    }
+    this->length = 0;
+    return std::move(this->storage);
+  }
+
+  bool operator==(const Bitset &other) const {
+    return this->length == other.length && this->storage == other.storage;
+  }
+
+  bool operator!=(const Bitset &other) const {
+    return !(*this == other);
+  }
+
+ private:
+
+  static size_t word_count(size_t size) {
+    return (size + 31) / 32;
+  }
+
+  void check_size(const Bitset &other) const {
+    if (this->length != other.length) {
+      throw std::invalid_argument("Bitset sizes differ");
+    }
+  }
+
+  void clear_tail() {
+    if (this->length % 32 != 0) {
+      *(this->words() + this->word_size() - 1) &= (uint32_t(1) << (this->length % 32)) - 1;
+    }
+  }
+
+  size_t length = 0;
+  std::vector<int> storage;
+
+};
+
+inline Bitset operator|(Bitset left, const Bitset &right) {
+  left |= right;
+  return left;
+}
+
+inline Bitset operator&(Bitset left, const Bitset &right) {
+  left &= right;
+  return left;
+}
+
+inline Bitset operator^(Bitset left, const Bitset &right) {
+  left ^= right;
+  return left;
+}
+
+inline Bitset and_not(Bitset left, const Bitset &right) {
+  left.and_not(right);
+  return left;
+}
+
+}  // namespace task
@@ -0,0 +1,274 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "vector_kernels.h"
+
+namespace task {
+
+// CRTP base of everything that can appear in a lazy element-wise vector expression.
+// Nodes expose size() and an unchecked at(i); nothing is computed until the expression is
+// assigned, and then every element is produced in one pass over the operands.
+template <class E>
+class VectorExpr {
+
+ public:
+
+  const E &self() const {
+    return static_cast<const E &>(*this);
+  }
+
+  // Evaluates into a new vector; assign() reuses an existing one instead.
+  operator std::vector<double>() const;
+
+};
+
+template <class E>
+struct is_vector_expr : std::is_base_of<VectorExpr<E>, E> {};
+
+// Non-owning leaf over a std::vector<double>; the vector must outlive the expression.
+class VectorRef : public VectorExpr<VectorRef> {
+
+ public:
+
+  VectorRef(const std::vector<double> &source) : values(source.data()), length(source.size()) {}
+
+  size_t size() const {
+    return this->length;
+  }
+
+  double at(size_t i) const {
+    return *(this->values + i);
+  }
+
+ private:
+
+  const double *values;
+  size_t length;
+
+};
+
+// Starts a lazy expression: lazy(a) + b - c is evaluated without temporaries.
+inline VectorRef lazy(const std::vector<double> &source) {
+  return VectorRef(source);
+}
+
+// Plain vectors taking part in a lazy expression are wrapped in a VectorRef.
+template <class E>
+struct vector_operand {
+  using type = E;
+};
+
+template <>
+struct vector_operand<std::vector<double>> {
+  using type = VectorRef;
+};
+
+template <class E>
+using vector_operand_t = typename vector_operand<E>::type;
+
+template <class E>
+constexpr bool is_lazy_operand = is_vector_expr<E>::value || std::is_same<E, std::vector<double>>::value;
+
+// At least one side must already be an expression: vector + vector stays eager.
+template <class L, class R>
+using enable_if_lazy = std::enable_if_t<is_lazy_operand<L> && is_lazy_operand<R> &&
+                                        (is_vector_expr<L>::value || is_vector_expr<R>::value)>;
+
+template <class E>
+using enable_if_vector_expr = std::enable_if_t<is_vector_expr<E>::value>;
+
+struct ExprPlus {
+  static double apply(double left, double right) {
+    return left + right;
+  }
+};
+
+struct ExprMinus {
+  static double apply(double left, double right) {
+    return left - right;
+  }
+};
+
+// Like the eager operators, a binary node has the size of its left operand.
+template <class L, class R, class Op>
+class VectorBinaryExpr : public VectorExpr<VectorBinaryExpr<L, R, Op>> {
+
+ public:
+
+  VectorBinaryExpr(const L &left, const R &right) : left(left), right(right) {}
+
+  size_t size() const {
+    return this->left.size();
+  }
+
+  double at(size_t i) const {
+    return Op::apply(this->left.at(i), this->right.at(i));
+  }
+
+ private:
+
+  const L left;
+  const R right;
+
+};
+
+template <class E>
+class VectorScaledExpr : public VectorExpr<VectorScaledExpr<E>> {
+
+ public:
+
+  VectorScaledExpr(const E &source, double factor) : source(source), factor(factor) {}
+
+  size_t size() const {
+    return this->source.size();
+  }
+
+  double at(size_t i) const {
+    return this->factor * this->source.at(i);
+  }
+
+ private:
+
+  const E source;
+  double factor;
+
+};
+
+template <class E>
+class VectorNegatedExpr : public VectorExpr<VectorNegatedExpr<E>> {
+
+ public:
+
+  explicit VectorNegatedExpr(const E &source) : source(source) {}
+
+  size_t size() const {
+    return this->source.size();
+  }
+
+  double at(size_t i) const {
+    return -this->source.at(i);
+  }
+
+ private:
+
+  const E source;
+
+};
+
+template <class L, class R, class = enable_if_lazy<L, R>>
+VectorBinaryExpr<vector_operand_t<L>, vector_operand_t<R>, ExprPlus> operator+(const L &left,
+                                                                               const R &right) {
+  return {vector_operand_t<L>(left), vector_operand_t<R>(right)};
+}
+
+template <class L, class R, class = enable_if_lazy<L, R>>
+VectorBinaryExpr<vector_operand_t<L>, vector_operand_t<R>, ExprMinus> operator-(const L &left,
+                                                                                const R &right) {
+  return {vector_operand_t<L>(left), vector_operand_t<R>(right)};
+}
+
+template <class E, class = enable_if_vector_expr<E>>
+VectorNegatedExpr<E> operator-(const E &source) {
+  return VectorNegatedExpr<E>(source);
+}
+
+template <class E, class = enable_if_vector_expr<E>>
+VectorScaledExpr<E> operator*(const E &source, double factor) {
+  return VectorScaledExpr<E>(source, factor);
+}
+
+template <class E, class = enable_if_vector_expr<E>>
+VectorScaledExpr<E> operator*(double factor, const E &source) {
+  return VectorScaledExpr<E>(source, factor);
+}
+
+namespace detail {
+
+// Blocks of a fixed width let -O2's cheap vectorizer cost model take the loop, which it
+// rejects for an unknown trip count; EXPR_BLOCK covers one 512-bit register or two 256-bit.
+constexpr size_t EXPR_BLOCK = 8;
+
+// Inlined into each per-ISA entry point below, so the nodes' at() calls are compiled for it.
+template <class E>
+__attribute__((always_inline)) inline void evaluate_blocks(double *destination, const E &expr,
+                                                           size_t n) {
+  size_t i = 0;
+  for (; i + EXPR_BLOCK <= n; i += EXPR_BLOCK) {
+#pragma GCC ivdep
+    for (size_t k = 0; k < EXPR_BLOCK; ++k) {
+      *(destination + i + k) = expr.at(i + k);
+    }
+  }
+  for (; i < n; ++i) {
+    *(destination + i) = expr.at(i);
+  }
+}
+
+template <class E>
+void evaluate_generic(double *destination, const E &expr, size_t n) {
+  evaluate_blocks(destination, expr, n);
+}
+
+template <class E>
+__attribute__((target("avx2,fma"))) void evaluate_avx2(double *destination, const E &expr,
+                                                       size_t n) {
+  evaluate_blocks(destination, expr, n);
+}
+
+template <class E>
+__attribute__((target("avx512f"))) void evaluate_avx512(double *destination, const E &expr,
+                                                        size_t n) {
+  evaluate_blocks(destination, expr, n);
+}
+
+template <class E>
+void evaluate(double *destination, const E &expr, size_t n) {
+  switch (simd_level()) {
+    case SimdLevel::AVX512:
+      evaluate_avx512(destination, expr, n);
+      break;
+    case SimdLevel::AVX2:
+      evaluate_avx2(destination, expr, n);
+      break;
+    default:
+      evaluate_generic(destination, expr, n);
+  }
+}
+
+}  // namespace detail
+
+// destination = expr in one pass, reusing destination's storage when it already has the
+// right size. destination may appear in expr: element i only reads element i of operands.
+template <class E, class = enable_if_vector_expr<E>>
+void assign(std::vector<double> &destination, const E &expr) {
+  size_t n = expr.size();
+  if (destination.size() != n) {
+    std::vector<double> result(n);
+    detail::evaluate(result.data(), expr, n);
+    destination.swap(result);
+    return;
+  }
+  detail::evaluate(destination.data(), expr, n);
+}
+
+template <class E>
+VectorExpr<E>::operator std::vector<double>() const {
+  std::vector<double> result(self().size());
+  detail::evaluate(result.data(), self(), result.size());
+  return result;
+}
+
+template <class E, class = enable_if_vector_expr<E>>
+std::vector<double> &operator+=(std::vector<double> &destination, const E &expr) {
+  assign(destination, lazy(destination) + expr);
+  return destination;
+}
+
+template <class E, class = enable_if_vector_expr<E>>
+std::vector<double> &operator-=(std::vector<double> &destination, const E &expr) {
+  assign(destination, lazy(destination) - expr);
+  return destination;
+}
+
+}  // namespace task
@@ -0,0 +1,292 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include "vector_kernels.h"
+
+namespace task {
+
+// Largest distance between unit directions that the batch queries treat as equal.
+const double DIRECTION_TOL = 1e-12;
+
+// Grid cells are this many tolerances wide, so a direction is rarely within tolerance of a
+// cell face and usually probes a single bucket.
+const double DIRECTION_CELL = 16;
+
+// Directions are hashed by this many fixed pseudo-random projections, which see every
+// coordinate; it bounds the neighbouring cells a direction near several faces has to probe
+// (at most 2^DIRECTION_PROJECTIONS).
+const size_t DIRECTION_PROJECTIONS = 8;
+
+namespace detail {
+
+// Below this the sum of squares may have lost precision to underflow.
+const double DIRECTION_MIN_NORM = 1e-150;
+
+// splitmix64 finalizer: a fixed, well-spread function of x.
+inline uint64_t mix_bits(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Unit directions of a set of vectors, stored back to back, plus a spatial hash of the
+// group representatives chosen so far. The hash grid lives in the space of the projections
+// onto DIRECTION_PROJECTIONS pseudo-random unit directions: a projection onto a unit vector
+// never stretches distances, so directions within tolerance stay within tolerance in every
+// projected coordinate, while vectors differing in any coordinate, however late, usually
+// land in different cells.
+class DirectionIndex {
+
+ public:
+
+  DirectionIndex(const std::vector<std::vector<double>> &vectors, double tolerance)
+      : tolerance(tolerance), offsets(vectors.size() + 1) {
+    size_t longest = 0;
+    for (size_t i = 0; i < vectors.size(); ++i) {
+      this->offsets[i + 1] = this->offsets[i] + vectors[i].size();
+      longest = std::max(longest, vectors[i].size());
+    }
+    // A projection of d terms is off by at most d ulps of a unit length, so two directions
+    // within tolerance project within reach of each other.
+    double epsilon = std::numeric_limits<double>::epsilon();
+    this->reach = tolerance + 2 * static_cast<double>(longest) * epsilon;
+    this->cell = std::max(this->reach, epsilon) * DIRECTION_CELL;
+    this->units.resize(this->offsets.back());
+    this->zero.resize(vectors.size());
+    this->finite.resize(vectors.size(), true);
+    this->projections.resize(vectors.size() * DIRECTION_PROJECTIONS);
+    // weights[k * P + j] is coordinate k of projection direction j, uniform in [-1, 1);
+    // squares[d * P + j] is its squared length over the first d coordinates.
+    const size_t P = DIRECTION_PROJECTIONS;
+    std::vector<double> weights(longest * P);
+    std::vector<double> squares((longest + 1) * P);
+    for (size_t k = 0; k < longest; ++k) {
+      for (size_t j = 0; j < P; ++j) {
+        double weight = static_cast<double>(mix_bits(k * P + j) >> 11) * 0x1.0p-52 - 1.0;
+        weights[k * P + j] = weight;
+        squares[(k + 1) * P + j] = squares[k * P + j] + weight * weight;
+      }
+    }
+    for (size_t i = 0; i < vectors.size(); ++i) {
+      const std::vector<double> &source = vectors[i];
+      double norm = std::sqrt(kernels::dot(source.data(), source.data(), source.size()));
+      if (std::isinf(norm) || norm < DIRECTION_MIN_NORM) {
+        // The squares overflowed or underflowed; take the norm of source / max |source[k]|.
+        double largest = 0;
+        for (double value : source) {
+          largest = std::max(largest, std::fabs(value));
+        }
+        double scaled = 0;
+        for (size_t k = 0; largest > 0 && k < source.size(); ++k) {
+          scaled += (source[k] / largest) * (source[k] / largest);
+        }
+        norm = largest * std::sqrt(scaled);
+      }
+      // A NaN or infinite component leaves no direction to compare.
+      if (!std::isfinite(norm)) {
+        this->finite[i] = false;
+        continue;
+      }
+      this->zero[i] = !(norm > 0);
+      if (this->zero[i]) {
+        continue;
+      }
+      double *unit = this->units.data() + this->offsets[i];
+      double *projection = this->projections.data() + i * P;
+      for (size_t k = 0; k < source.size(); ++k) {
+        unit[k] = source[k] / norm;
+        for (size_t j = 0; j < P; ++j) {
+          projection[j] += unit[k] * weights[k * P + j];
+        }
+      }
+      for (size_t j = 0; j < P; ++j) {
+        projection[j] /= std::sqrt(squares[source.size() * P + j]);
+      }
+    }
+  }
+
+  bool is_zero(size_t i) const {
+    return this->zero[i];
+  }
+
+  bool is_finite(size_t i) const {
+    return this->finite[i];
+  }
+
+  // Representative within tolerance of i (or of -i when either_sign is set), or npos.
+  size_t find(size_t i, bool either_sign) {
+    size_t found = this->find_signed(i, 1.);
+    if (found == npos && either_sign) {
+      found = this->find_signed(i, -1.);
+    }
+    return found;
+  }
+
+  void add_representative(size_t i) {
+    this->cells(i, 1.);
+    this->buckets[this->hash_cells()].push_back(i);
+  }
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+ private:
+
+  size_t dimension(size_t i) const {
+    return this->offsets[i + 1] - this->offsets[i];
+  }
+
+  // Grid cells of the projections of sign * unit(i). The grid is shifted by half a cell so
+  // that projections of exactly zero sit in the middle of a cell.
+  void cells(size_t i, double sign) {
+    const double *projection = this->projections.data() + i * DIRECTION_PROJECTIONS;
+    this->key.resize(DIRECTION_PROJECTIONS);
+    this->position.resize(DIRECTION_PROJECTIONS);
+    for (size_t k = 0; k < DIRECTION_PROJECTIONS; ++k) {
+      double scaled = sign * projection[k] / this->cell + 0.5;
+      double floor = std::floor(scaled);
+      this->key[k] = static_cast<int64_t>(floor);
+      this->position[k] = (scaled - floor) * this->cell;
+    }
+    this->hashed_dimension = this->dimension(i);
+  }
+
+  uint64_t hash_cells() const {
+    uint64_t hash = this->hashed_dimension * 0x9e3779b97f4a7c15ULL;
+    for (int64_t value : this->key) {
+      hash ^= static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+  }
+
+  bool close(size_t candidate, size_t i, double sign) const {
+    if (this->dimension(candidate) != this->dimension(i)) {
+      return false;
+    }
+    const double *left = this->units.data() + this->offsets[candidate];
+    const double *right = this->units.data() + this->offsets[i];
+    double limit = this->tolerance * this->tolerance;
+    double distance = 0;
+    for (size_t k = 0; k < this->dimension(i); ++k) {
+      double difference = left[k] - sign * right[k];
+      distance += difference * difference;
+      if (distance > limit) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Probes the cell of sign * unit(i) and every neighbour across a face closer than the
+  // reach; collisions in the hash only add candidates, which close() rejects.
+  size_t find_signed(size_t i, double sign) {
+    this->cells(i, sign);
+    this->faces.clear();
+    for (size_t k = 0; k < this->key.size(); ++k) {
+      if (this->position[k] <= this->reach) {
+        this->faces.push_back({k, -1});
+      } else if (this->cell - this->position[k] <= this->reach) {
+        this->faces.push_back({k, 1});
+      }
+    }
+    for (size_t mask = 0; mask < (size_t(1) << this->faces.size()); ++mask) {
+      for (size_t f = 0; f < this->faces.size(); ++f) {
+        this->key[this->faces[f].first] += (mask >> f & 1) * this->faces[f].second;
+      }
+      auto bucket = this->buckets.find(this->hash_cells());
+      for (size_t f = 0; f < this->faces.size(); ++f) {
+        this->key[this->faces[f].first] -= (mask >> f & 1) * this->faces[f].second;
+      }
+      if (bucket == this->buckets.end()) {
+        continue;
+      }
+      for (size_t candidate : bucket->second) {
+        if (this->close(candidate, i, sign)) {
+          return candidate;
+        }
+      }
+    }
+    return npos;
+  }
+
+  double tolerance;
+  double reach;
+  double cell;
+  std::vector<size_t> offsets;
+  std::vector<double> units;
+  std::vector<bool> zero;
+  std::vector<bool> finite;
+  // DIRECTION_PROJECTIONS projections of each unit direction.
+  std::vector<double> projections;
+  std::unordered_map<uint64_t, std::vector<size_t>> buckets;
+
+  std::vector<int64_t> key;
+  std::vector<double> position;
+  std::vector<std::pair<size_t, int64_t>> faces;
+  size_t hashed_dimension = 0;
+
+};
+
+// Each vector joins the group of the first earlier representative whose direction is within
+// tolerance, or starts a new group; members are thus within tolerance of their group's first
+// element. Expected O(n d) time for n vectors of dimension d, as long as directions that
+// are not within tolerance rarely share all their projected cells.
+inline std::vector<std::vector<size_t>> group_directions(
+    const std::vector<std::vector<double>> &vectors, double tolerance, bool either_sign) {
+  DirectionIndex index(vectors, tolerance);
+  std::vector<std::vector<size_t>> groups;
+  std::vector<size_t> group_of(vectors.size());
+  std::unordered_map<size_t, size_t> zero_groups;
+  for (size_t i = 0; i < vectors.size(); ++i) {
+    if (!index.is_finite(i)) {
+      groups.push_back({i});
+      continue;
+    }
+    if (index.is_zero(i)) {
+      // As with operator|| and operator&&, zero vectors are collinear with each other only
+      // and codirectional with nothing.
+      if (either_sign) {
+        auto inserted = zero_groups.emplace(vectors[i].size(), groups.size());
+        if (!inserted.second) {
+          groups[inserted.first->second].push_back(i);
+          continue;
+        }
+      }
+      groups.push_back({i});
+      continue;
+    }
+    size_t representative = index.find(i, either_sign);
+    if (representative != DirectionIndex::npos) {
+      groups[group_of[representative]].push_back(i);
+      continue;
+    }
+    group_of[i] = groups.size();
+    groups.push_back({i});
+    index.add_representative(i);
+  }
+  return groups;
+}
+
+}  // namespace detail
+
+// Partitions vectors into groups of collinear ones (same direction up to sign), comparing
+// unit directions rather than component ratios. Groups hold indices into vectors in
+// increasing order and are ordered by their first element; singletons are included. A vector
+// with a NaN or infinite component is a group of its own.
+inline std::vector<std::vector<size_t>> collinear_groups(
+    const std::vector<std::vector<double>> &vectors, double tolerance = DIRECTION_TOL) {
+  return detail::group_directions(vectors, tolerance, true);
+}
+
+// Like collinear_groups, but vectors pointing in opposite directions are kept apart.
+inline std::vector<std::vector<size_t>> codirectional_groups(
+    const std::vector<std::vector<double>> &vectors, double tolerance = DIRECTION_TOL) {
+  return detail::group_directions(vectors, tolerance, false);
+}
+
+}  // namespace task
@@ -0,0 +1,653 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace task {
+
+enum class SimdLevel {
+  SSE2,
+  AVX2,
+  AVX512
+};
+
+// Widest instruction set supported by the running CPU, detected once via cpuid.
+inline SimdLevel simd_level() {
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+  }();
+  return level;
+}
+
+// How a dot product adds up its terms.
+enum class Summation {
+  // Four independent SIMD accumulators: the error bound of plain summation, at memory speed.
+  Fast,
+  // Error-free product and sum transformations (Ogita, Rump and Oishi's Dot2): the result is
+  // as accurate as if computed in twice the working precision.
+  Compensated,
+  // PAIRWISE_BLOCK-long fast blocks combined by a balanced tree: error grows with log n.
+  Pairwise
+};
+
+const size_t PAIRWISE_BLOCK = 256;
+
+namespace kernels {
+
+namespace detail {
+
+struct KernelTable {
+  double (*dot)(const double *, const double *, size_t);
+  double (*dot_compensated)(const double *, const double *, size_t);
+  void (*add)(double *, const double *, const double *, size_t);
+  void (*sub)(double *, const double *, const double *, size_t);
+  void (*negate)(double *, const double *, size_t);
+  void (*axpy)(double *, double, const double *, size_t);
+};
+
+// Error-free transformations: a + b = sum + error and a * b = product + error exactly.
+inline void two_sum(double a, double b, double &sum, double &error) {
+  sum = a + b;
+  double z = sum - a;
+  error = (a - (sum - z)) + (b - z);
+}
+
+// Folds per-lane compensated sums (sums[i] + errors[i]) into one value.
+inline double fold_compensated(const double *sums, const double *errors, size_t lanes) {
+  double sum = 0;
+  double error = 0;
+  for (size_t i = 0; i < lanes; ++i) {
+    double lane_error;
+    two_sum(sum, *(sums + i), sum, lane_error);
+    error += lane_error + *(errors + i);
+  }
+  return sum + error;
+}
+
+inline double dot_sse2(const double *a, const double *b, size_t n) {
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  __m128d acc2 = _mm_setzero_pd();
+  __m128d acc3 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(a + i + 4), _mm_loadu_pd(b + i + 4)));
+    acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_loadu_pd(a + i + 6), _mm_loadu_pd(b + i + 6)));
+  }
+  for (; i + 2 <= n; i += 2) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+  }
+  __m128d acc = _mm_add_pd(_mm_add_pd(acc0, acc1), _mm_add_pd(acc2, acc3));
+  double lanes[2];
+  _mm_storeu_pd(lanes, acc);
+  double result = lanes[0] + lanes[1];
+  for (; i < n; ++i) {
+    result += *(a + i) * *(b + i);
+  }
+  return result;
+}
+
+inline double dot_compensated_scalar(const double *a, const double *b, size_t n) {
+  double sum = 0;
+  double error = 0;
+  for (size_t i = 0; i < n; ++i) {
+    double product = *(a + i) * *(b + i);
+    double product_error = std::fma(*(a + i), *(b + i), -product);
+    double sum_error;
+    two_sum(sum, product, sum, sum_error);
+    error += product_error + sum_error;
+  }
+  return sum + error;
+}
+
+inline void add_sse2(double *dst, const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = *(a + i) + *(b + i);
+  }
+}
+
+inline void sub_sse2(double *dst, const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = *(a + i) - *(b + i);
+  }
+}
+
+inline void negate_sse2(double *dst, const double *src, size_t n) {
+  __m128d sign = _mm_set1_pd(-0.0);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_xor_pd(_mm_loadu_pd(src + i), sign));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = -*(src + i);
+  }
+}
+
+inline void axpy_sse2(double *dst, double alpha, const double *src, size_t n) {
+  __m128d factor = _mm_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d product = _mm_mul_pd(_mm_loadu_pd(src + i), factor);
+    _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), product));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) += alpha * *(src + i);
+  }
+}
+
+__attribute__((target("avx2,fma"))) inline double dot_avx2(const double *a, const double *b,
+                                                           size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  __m256d acc2 = _mm256_setzero_pd();
+  __m256d acc3 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+    acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), acc2);
+    acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), acc3);
+  }
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+  }
+  __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  double result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < n; ++i) {
+    result += *(a + i) * *(b + i);
+  }
+  return result;
+}
+
+// Two independent (sum, error) pairs of lanes hide the latency of the two_sum chain.
+__attribute__((target("avx2,fma"))) inline double dot_compensated_avx2(const double *a,
+                                                                       const double *b,
+                                                                       size_t n) {
+  __m256d sum[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+  __m256d error[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    for (size_t k = 0; k < 2; ++k) {
+      __m256d x = _mm256_loadu_pd(a + i + 4 * k);
+      __m256d y = _mm256_loadu_pd(b + i + 4 * k);
+      __m256d product = _mm256_mul_pd(x, y);
+      __m256d product_error = _mm256_fmsub_pd(x, y, product);
+      __m256d total = _mm256_add_pd(sum[k], product);
+      __m256d z = _mm256_sub_pd(total, sum[k]);
+      __m256d sum_error = _mm256_add_pd(_mm256_sub_pd(sum[k], _mm256_sub_pd(total, z)),
+                                        _mm256_sub_pd(product, z));
+      error[k] = _mm256_add_pd(error[k], _mm256_add_pd(product_error, sum_error));
+      sum[k] = total;
+    }
+  }
+  double sums[9];
+  double errors[9];
+  _mm256_storeu_pd(sums, sum[0]);
+  _mm256_storeu_pd(sums + 4, sum[1]);
+  _mm256_storeu_pd(errors, error[0]);
+  _mm256_storeu_pd(errors + 4, error[1]);
+  sums[8] = dot_compensated_scalar(a + i, b + i, n - i);
+  errors[8] = 0;
+  return fold_compensated(sums, errors, 9);
+}
+
+__attribute__((target("avx2"))) inline void add_avx2(double *dst, const double *a,
+                                                     const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d x0 = _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    __m256d x1 = _mm256_add_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+    _mm256_storeu_pd(dst + i, x0);
+    _mm256_storeu_pd(dst + i + 4, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = *(a + i) + *(b + i);
+  }
+}
+
+__attribute__((target("avx2"))) inline void sub_avx2(double *dst, const double *a,
+                                                     const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d x0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    __m256d x1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+    _mm256_storeu_pd(dst + i, x0);
+    _mm256_storeu_pd(dst + i + 4, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = *(a + i) - *(b + i);
+  }
+}
+
+__attribute__((target("avx2"))) inline void negate_avx2(double *dst, const double *src,
+                                                        size_t n) {
+  __m256d sign = _mm256_set1_pd(-0.0);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d x0 = _mm256_xor_pd(_mm256_loadu_pd(src + i), sign);
+    __m256d x1 = _mm256_xor_pd(_mm256_loadu_pd(src + i + 4), sign);
+    _mm256_storeu_pd(dst + i, x0);
+    _mm256_storeu_pd(dst + i + 4, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = -*(src + i);
+  }
+}
+
+__attribute__((target("avx2,fma"))) inline void axpy_avx2(double *dst, double alpha,
+                                                          const double *src, size_t n) {
+  __m256d factor = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d x0 = _mm256_fmadd_pd(_mm256_loadu_pd(src + i), factor, _mm256_loadu_pd(dst + i));
+    __m256d x1 = _mm256_fmadd_pd(_mm256_loadu_pd(src + i + 4), factor,
+                                 _mm256_loadu_pd(dst + i + 4));
+    _mm256_storeu_pd(dst + i, x0);
+    _mm256_storeu_pd(dst + i + 4, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) += alpha * *(src + i);
+  }
+}
+
+__attribute__((target("avx512f"))) inline double dot_avx512(const double *a, const double *b,
+                                                            size_t n) {
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  __m512d acc2 = _mm512_setzero_pd();
+  __m512d acc3 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+    acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+    acc2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), acc2);
+    acc3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), acc3);
+  }
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+  }
+  if (i < n) {
+    __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+    acc1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i),
+                           acc1);
+  }
+  __m512d acc = _mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3));
+  // Reduced through memory like dot_avx2: GCC 12's _mm512_reduce_add_pd reads an undefined
+  // vector and trips -Wuninitialized.
+  double lanes[8];
+  _mm512_storeu_pd(lanes, acc);
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+      ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+__attribute__((target("avx512f"))) inline double dot_compensated_avx512(const double *a,
+                                                                        const double *b,
+                                                                        size_t n) {
+  __m512d sum[2] = {_mm512_setzero_pd(), _mm512_setzero_pd()};
+  __m512d error[2] = {_mm512_setzero_pd(), _mm512_setzero_pd()};
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    for (size_t k = 0; k < 2; ++k) {
+      __m512d x = _mm512_loadu_pd(a + i + 8 * k);
+      __m512d y = _mm512_loadu_pd(b + i + 8 * k);
+      __m512d product = _mm512_mul_pd(x, y);
+      __m512d product_error = _mm512_fmsub_pd(x, y, product);
+      __m512d total = _mm512_add_pd(sum[k], product);
+      __m512d z = _mm512_sub_pd(total, sum[k]);
+      __m512d sum_error = _mm512_add_pd(_mm512_sub_pd(sum[k], _mm512_sub_pd(total, z)),
+                                        _mm512_sub_pd(product, z));
+      error[k] = _mm512_add_pd(error[k], _mm512_add_pd(product_error, sum_error));
+      sum[k] = total;
+    }
+  }
+  double sums[17];
+  double errors[17];
+  _mm512_storeu_pd(sums, sum[0]);
+  _mm512_storeu_pd(sums + 8, sum[1]);
+  _mm512_storeu_pd(errors, error[0]);
+  _mm512_storeu_pd(errors + 8, error[1]);
+  sums[16] = dot_compensated_scalar(a + i, b + i, n - i);
+  errors[16] = 0;
+  return fold_compensated(sums, errors, 17);
+}
+
+__attribute__((target("avx512f"))) inline void add_avx512(double *dst, const double *a,
+                                                          const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d x0 = _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+    __m512d x1 = _mm512_add_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+    _mm512_storeu_pd(dst + i, x0);
+    _mm512_storeu_pd(dst + i + 8, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = *(a + i) + *(b + i);
+  }
+}
+
+__attribute__((target("avx512f"))) inline void sub_avx512(double *dst, const double *a,
+                                                          const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d x0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+    __m512d x1 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+    _mm512_storeu_pd(dst + i, x0);
+    _mm512_storeu_pd(dst + i + 8, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = *(a + i) - *(b + i);
+  }
+}
+
+// Sign flip as an integer xor: _mm512_xor_pd needs AVX512DQ.
+__attribute__((target("avx512f"))) inline void negate_avx512(double *dst, const double *src,
+                                                             size_t n) {
+  __m512i sign = _mm512_set1_epi64(static_cast<long long>(1ull << 63));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i x0 = _mm512_xor_si512(_mm512_castpd_si512(_mm512_loadu_pd(src + i)), sign);
+    __m512i x1 = _mm512_xor_si512(_mm512_castpd_si512(_mm512_loadu_pd(src + i + 8)), sign);
+    _mm512_storeu_pd(dst + i, _mm512_castsi512_pd(x0));
+    _mm512_storeu_pd(dst + i + 8, _mm512_castsi512_pd(x1));
+  }
+  for (; i < n; ++i) {
+    *(dst + i) = -*(src + i);
+  }
+}
+
+__attribute__((target("avx512f"))) inline void axpy_avx512(double *dst, double alpha,
+                                                           const double *src, size_t n) {
+  __m512d factor = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d x0 = _mm512_fmadd_pd(_mm512_loadu_pd(src + i), factor, _mm512_loadu_pd(dst + i));
+    __m512d x1 = _mm512_fmadd_pd(_mm512_loadu_pd(src + i + 8), factor,
+                                 _mm512_loadu_pd(dst + i + 8));
+    _mm512_storeu_pd(dst + i, x0);
+    _mm512_storeu_pd(dst + i + 8, x1);
+  }
+  for (; i < n; ++i) {
+    *(dst + i) += alpha * *(src + i);
+  }
+}
+
+inline const KernelTable &kernel_table() {
+  static const KernelTable table = []() -> KernelTable {
+    switch (simd_level()) {
+      case SimdLevel::AVX512:
+        return {dot_avx512, dot_compensated_avx512, add_avx512, sub_avx512, negate_avx512,
+                axpy_avx512};
+      case SimdLevel::AVX2:
+        return {dot_avx2, dot_compensated_avx2, add_avx2, sub_avx2, negate_avx2, axpy_avx2};
+      default:
+        return {dot_sse2, dot_compensated_scalar, add_sse2, sub_sse2, negate_sse2, axpy_sse2};
+    }
+  }();
+  return table;
+}
+
+// Halves are split on PAIRWISE_BLOCK boundaries, so the tree depends only on n.
+inline double dot_pairwise(const double *a, const double *b, size_t n) {
+  if (n <= PAIRWISE_BLOCK) {
+    return kernel_table().dot(a, b, n);
+  }
+  size_t half = (n / PAIRWISE_BLOCK + 1) / 2 * PAIRWISE_BLOCK;
+  return dot_pairwise(a, b, half) + dot_pairwise(a + half, b + half, n - half);
+}
+
+// Bit kernels work on 32-bit words, the unsigned counterpart of int, so that a packed bitset
+// can live in the buffer of the std::vector<int> mask it came from. dst may alias a.
+struct BitKernelTable {
+  void (*bit_or)(uint32_t *, const uint32_t *, const uint32_t *, size_t);
+  void (*bit_and)(uint32_t *, const uint32_t *, const uint32_t *, size_t);
+  void (*bit_xor)(uint32_t *, const uint32_t *, const uint32_t *, size_t);
+  void (*bit_andnot)(uint32_t *, const uint32_t *, const uint32_t *, size_t);
+  size_t (*popcount)(const uint32_t *, size_t);
+  void (*pack)(uint32_t *, const int *, size_t);
+};
+
+inline void bit_or_scalar(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    *(dst + i) = *(a + i) | *(b + i);
+  }
+}
+
+inline void bit_and_scalar(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    *(dst + i) = *(a + i) & *(b + i);
+  }
+}
+
+inline void bit_xor_scalar(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    *(dst + i) = *(a + i) ^ *(b + i);
+  }
+}
+
+inline void bit_andnot_scalar(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    *(dst + i) = *(a + i) & ~*(b + i);
+  }
+}
+
+inline size_t popcount_scalar(const uint32_t *words, size_t n) {
+  size_t result = 0;
+  for (size_t i = 0; i < n; ++i) {
+    result += __builtin_popcount(*(words + i));
+  }
+  return result;
+}
+
+// Word j takes bits 32j..32j+31 from src[32j..32j+31] != 0 and is written only after they
+// are read, so dst may be src itself: packing in place never overwrites unread input.
+inline void pack_scalar(uint32_t *dst, const int *src, size_t n) {
+  for (size_t j = 0; j * 32 < n; ++j) {
+    uint32_t word = 0;
+    for (size_t k = 0; k < 32 && j * 32 + k < n; ++k) {
+      word |= static_cast<uint32_t>(*(src + j * 32 + k) != 0) << k;
+    }
+    *(dst + j) = word;
+  }
+}
+
+// The bit kernels are bandwidth bound, so AVX-512 machines use the AVX2 versions as well.
+__attribute__((target("avx2"))) inline void bit_or_avx2(uint32_t *dst, const uint32_t *a,
+                                                        const uint32_t *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 8));
+    __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_or_si256(x0, y0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 8), _mm256_or_si256(x1, y1));
+  }
+  bit_or_scalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void bit_and_avx2(uint32_t *dst, const uint32_t *a,
+                                                         const uint32_t *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 8));
+    __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_and_si256(x0, y0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 8), _mm256_and_si256(x1, y1));
+  }
+  bit_and_scalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void bit_xor_avx2(uint32_t *dst, const uint32_t *a,
+                                                         const uint32_t *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 8));
+    __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_xor_si256(x0, y0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 8), _mm256_xor_si256(x1, y1));
+  }
+  bit_xor_scalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void bit_andnot_avx2(uint32_t *dst, const uint32_t *a,
+                                                            const uint32_t *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 8));
+    __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_andnot_si256(y0, x0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 8), _mm256_andnot_si256(y1, x1));
+  }
+  bit_andnot_scalar(dst + i, a + i, b + i, n - i);
+}
+
+// Nibble lookup with pshufb (Mula): each byte holds the popcount of its source byte. Up to
+// eight vectors are added bytewise (at most 64 per byte) before widening with sad_epu8.
+__attribute__((target("avx2,popcnt"))) inline size_t popcount_avx2(const uint32_t *words,
+                                                                   size_t n) {
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  while (i + 8 <= n) {
+    __m256i bytes = _mm256_setzero_si256();
+    for (size_t k = 0; k < 8 && i + 8 <= n; ++k, i += 8) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+      __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, nibble));
+      __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+      bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(low, high));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), total);
+  size_t result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < n; ++i) {
+    result += _mm_popcnt_u32(*(words + i));
+  }
+  return result;
+}
+
+// Four compares and movemasks give the 32 bits of a word; as in pack_scalar, all of its
+// inputs are loaded before it is stored.
+__attribute__((target("avx2"))) inline void pack_avx2(uint32_t *dst, const int *src, size_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t j = 0;
+  for (; j * 32 + 32 <= n; ++j) {
+    uint32_t word = 0;
+    for (size_t k = 0; k < 4; ++k) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + j * 32 + k * 8));
+      __m256i is_zero = _mm256_cmpeq_epi32(x, zero);
+      uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(is_zero)));
+      word |= (~bits & 0xff) << (k * 8);
+    }
+    *(dst + j) = word;
+  }
+  pack_scalar(dst + j, src + j * 32, n - j * 32);
+}
+
+inline const BitKernelTable &bit_kernel_table() {
+  static const BitKernelTable table = []() -> BitKernelTable {
+    if (simd_level() == SimdLevel::SSE2) {
+      return {bit_or_scalar, bit_and_scalar, bit_xor_scalar, bit_andnot_scalar, popcount_scalar,
+              pack_scalar};
+    }
+    return {bit_or_avx2, bit_and_avx2, bit_xor_avx2, bit_andnot_avx2, popcount_avx2, pack_avx2};
+  }();
+  return table;
+}
+
+}  // namespace detail
+
+inline double dot(const double *a, const double *b, size_t n,
+                  Summation summation = Summation::Fast) {
+  switch (summation) {
+    case Summation::Compensated:
+      return detail::kernel_table().dot_compensated(a, b, n);
+    case Summation::Pairwise:
+      return detail::dot_pairwise(a, b, n);
+    default:
+      return detail::kernel_table().dot(a, b, n);
+  }
+}
+
+// dst[i] = a[i] + b[i]; dst may alias a or b
+inline void add(double *dst, const double *a, const double *b, size_t n) {
+  detail::kernel_table().add(dst, a, b, n);
+}
+
+// dst[i] = a[i] - b[i]; dst may alias a or b
+inline void sub(double *dst, const double *a, const double *b, size_t n) {
+  detail::kernel_table().sub(dst, a, b, n);
+}
+
+// dst[i] = -src[i]; dst may alias src
+inline void negate(double *dst, const double *src, size_t n) {
+  detail::kernel_table().negate(dst, src, n);
+}
+
+// dst[i] += alpha * src[i]
+inline void axpy(double *dst, double alpha, const double *src, size_t n) {
+  detail::kernel_table().axpy(dst, alpha, src, n);
+}
+
+// dst[i] = a[i] | b[i] over n words
+inline void bit_or(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  detail::bit_kernel_table().bit_or(dst, a, b, n);
+}
+
+// dst[i] = a[i] & b[i] over n words
+inline void bit_and(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  detail::bit_kernel_table().bit_and(dst, a, b, n);
+}
+
+// dst[i] = a[i] ^ b[i] over n words
+inline void bit_xor(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  detail::bit_kernel_table().bit_xor(dst, a, b, n);
+}
+
+// dst[i] = a[i] & ~b[i] over n words
+inline void bit_andnot(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n) {
+  detail::bit_kernel_table().bit_andnot(dst, a, b, n);
+}
+
+// Number of set bits in n words
+inline size_t popcount(const uint32_t *words, size_t n) {
+  return detail::bit_kernel_table().popcount(words, n);
+}
+
+// Bit i of dst = (src[i] != 0) for n ints; dst may point to src's own storage.
+inline void pack(uint32_t *dst, const int *src, size_t n) {
+  detail::bit_kernel_table().pack(dst, src, n);
+}
+
+}  // namespace kernels
+
+}  // namespace task
@@ -3,6 +3,11 @@
 #include <iostream>
 #include "algorithm"
 #include "cmath"
+#include "bitset.h"
+#include "vector_expr.h"
+#include "vector_groups.h"
+#include "vector_kernels.h"
+#include "vector_parallel.h"
 
 using std::vector;
 
@@ -17,34 +22,44 @@ vector<double> operator+(const vector<double> &source) {
 
 vector<double> operator-(const vector<double> &source) {
   vector<double> result(source.size());
-  for (int i = 0; i < source.size(); ++i) {
-    result[i] = -source[i];
-  }
+  kernels::negate(result.data(), source.data(), source.size());
   return result;
 }
 
 vector<double> operator+(const vector<double> &left, const vector<double> &right) {
   vector<double> result(left.size());
-  for (int i = 0; i < left.size(); ++i) {
-    result[i] = left[i] + right[i];
-  }
+  kernels::add(result.data(), left.data(), right.data(), left.size());
   return result;
 }
 
 vector<double> operator-(const vector<double> &left, const vector<double> &right) {
   vector<double> result(left.size());
-  for (int i = 0; i < left.size(); ++i) {
-    result[i] = left[i] - right[i];
-  }
+  kernels::sub(result.data(), left.data(), right.data(), left.size());
   return result;
 }
 
+vector<double> &operator+=(vector<double> &left, const vector<double> &right) {
+  kernels::add(left.data(), left.data(), right.data(), left.size());
+  return left;
+}
+
+vector<double> &operator-=(vector<double> &left, const vector<double> &right) {
+  kernels::sub(left.data(), left.data(), right.data(), left.size());
+  return left;
+}
+
+// y += alpha * x in place
+void axpy(vector<double> &y, double alpha, const vector<double> &x) {
+  kernels::axpy(y.data(), alpha, x.data(), y.size());
+}
+
+double dot(const vector<double> &left, const vector<double> &right,
+           Summation summation = Summation::Fast) {
+  return kernels::dot(left.data(), right.data(), right.size(), summation);
+}
+
 double operator*(const vector<double> &left, const vector<double> &right) {
-  double result = 0;
-  for (int i = 0; i < right.size(); ++i) {
-    result += left[i] * right[i];
-  }
-  return result;
+  return dot(left, right);
 }
 
 vector<double> operator%(const vector<double> &left, const vector<double> &right) {
@@ -55,9 +70,13 @@ vector<double> operator%(const vector<double> &left, const vector<double> &right
   return result;
 }
 
-bool operator||(const vector<double> &left, const vector<double> &right) {
+namespace detail {
+
+// Collinearity test shared by operator|| and operator&&; on success ratio holds left[i] / right[i]
+// of the first component where both are non-zero, and stays 0 for two zero vectors.
+bool collinear(const vector<double> &left, const vector<double> &right, double &ratio) {
   bool flag = false;
-  double fraction;
+  double fraction = 0;
   for (size_t i = 0; i < left.size(); ++i) {
     if (left[i] && right[i]) {
       double fraction_dif = left[i] / right[i] - fraction;
@@ -71,11 +90,21 @@ bool operator||(const vector<double> &left, const vector<double> &right) {
       return false;
     }
   }
+  ratio = fraction;
   return true;
 }
 
+}  // namespace detail
+
+bool operator||(const vector<double> &left, const vector<double> &right) {
+  double ratio;
+  return detail::collinear(left, right, ratio);
+}
+
+// Collinear vectors point the same way exactly when their component ratio is positive.
 bool operator&&(const vector<double> &left, const vector<double> &right) {
-  return (left || right) && (left * right > 0);
+  double ratio;
+  return detail::collinear(left, right, ratio) && ratio > 0;
 }
 
 std::istream &operator>>(std::istream &in, vector<double> &source) {
@@ -0,0 +1,318 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "vector_kernels.h"
+
+namespace task {
+namespace parallel {
+
+// Vectors shorter than this are handled on the calling thread.
+const size_t PARALLEL_MIN_SIZE = 1 << 16;
+
+// Elements per partial sum of dot. Fixed, so the reduction tree and therefore the result
+// depend only on the length (and the instruction set), never on threads or scheduling.
+const size_t REDUCTION_CHUNK = 1 << 14;
+
+// Used when the L2 size cannot be queried.
+const size_t DEFAULT_L2_BYTES = 1 << 20;
+
+// Fixed-size pool running one job at a time. A job is a number of chunks claimed from a shared
+// counter by the workers and the calling thread alike; run() returns once all are done.
+class ThreadPool {
+
+ public:
+
+  using Body = std::function<void(size_t)>;
+
+  explicit ThreadPool(size_t threads) {
+    for (size_t i = 1; i < std::max<size_t>(threads, 1); ++i) {
+      this->workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto &worker : this->workers) {
+      worker.join();
+    }
+  }
+
+  size_t size() const {
+    return this->workers.size() + 1;
+  }
+
+  // Calls body(chunk) for every chunk in [0, chunks). The first exception thrown by a chunk is
+  // rethrown here after the others finish; calls made from inside a chunk run serially.
+  void run(size_t chunks, const Body &body) {
+    if (chunks <= 1 || this->workers.empty() || inside_pool()) {
+      for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        body(chunk);
+      }
+      return;
+    }
+    std::lock_guard<std::mutex> exclusive(this->submit_lock);
+    Job job(body, chunks);
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      this->current = &job;
+      ++this->generation;
+    }
+    this->wake.notify_all();
+    inside_pool() = true;
+    work(job);
+    inside_pool() = false;
+    {
+      std::unique_lock<std::mutex> guard(this->lock);
+      this->current = nullptr;
+      this->done.wait(guard, [&job]() {
+        return job.users == 0;
+      });
+    }
+    if (job.error) {
+      std::rethrow_exception(job.error);
+    }
+  }
+
+ private:
+
+  struct Job {
+    Job(const Body &body, size_t chunks) : body(body), chunks(chunks) {}
+
+    const Body &body;
+    size_t chunks;
+    std::atomic<size_t> next{0};
+    size_t users = 0;
+    std::mutex error_lock;
+    std::exception_ptr error;
+  };
+
+  static bool &inside_pool() {
+    static thread_local bool inside = false;
+    return inside;
+  }
+
+  static void work(Job &job) {
+    size_t chunk;
+    while ((chunk = job.next.fetch_add(1, std::memory_order_relaxed)) < job.chunks) {
+      try {
+        job.body(chunk);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(job.error_lock);
+        if (!job.error) {
+          job.error = std::current_exception();
+        }
+      }
+    }
+  }
+
+  // A worker registers with the job under the lock, so run() cannot return while a worker
+  // still holds it; it can only join while run() is still claiming chunks itself.
+  void worker_loop() {
+    inside_pool() = true;
+    size_t seen = 0;
+    std::unique_lock<std::mutex> guard(this->lock);
+    while (true) {
+      this->wake.wait(guard, [this, &seen]() {
+        return this->stopping || (this->current != nullptr && this->generation != seen);
+      });
+      if (this->stopping) {
+        return;
+      }
+      seen = this->generation;
+      Job &job = *this->current;
+      ++job.users;
+      guard.unlock();
+      work(job);
+      guard.lock();
+      if (--job.users == 0) {
+        this->done.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex submit_lock;
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  Job *current = nullptr;
+  size_t generation = 0;
+  bool stopping = false;
+
+};
+
+namespace detail {
+
+inline std::shared_ptr<ThreadPool> &shared_pool() {
+  static std::shared_ptr<ThreadPool> pool;
+  return pool;
+}
+
+inline std::mutex &shared_pool_lock() {
+  static std::mutex lock;
+  return lock;
+}
+
+inline size_t l2_bytes() {
+  static const size_t bytes = []() {
+    long queried = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return queried > 0 ? static_cast<size_t>(queried) : DEFAULT_L2_BYTES;
+  }();
+  return bytes;
+}
+
+// Elements per chunk of an element-wise operation touching bytes_per_element across all of
+// its streams: half of L2, so a chunk's operands stay cached while it runs, in whole pages.
+inline size_t map_chunk(size_t bytes_per_element) {
+  size_t page = 4096;
+  size_t bytes = std::max(l2_bytes() / 2 / page * page, page);
+  return std::max<size_t>(bytes / bytes_per_element, 1);
+}
+
+}  // namespace detail
+
+// Process-wide pool, sized to the hardware by default. Callers hold the returned pointer
+// while they use the pool, so set_num_threads never destroys a pool that is still running.
+inline std::shared_ptr<ThreadPool> thread_pool() {
+  std::lock_guard<std::mutex> guard(detail::shared_pool_lock());
+  auto &pool = detail::shared_pool();
+  if (!pool) {
+    pool = std::make_shared<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+  }
+  return pool;
+}
+
+inline void set_num_threads(size_t threads) {
+  auto replacement = std::make_shared<ThreadPool>(threads);
+  {
+    std::lock_guard<std::mutex> guard(detail::shared_pool_lock());
+    detail::shared_pool().swap(replacement);
+  }
+  // replacement now holds the old pool, which is destroyed here unless still in use.
+}
+
+inline size_t num_threads() {
+  return thread_pool()->size();
+}
+
+// Calls body(begin, end) over consecutive chunks of [0, n) of at most chunk elements.
+template <class F>
+void for_chunks(size_t n, size_t chunk, const F &body) {
+  if (n < PARALLEL_MIN_SIZE) {
+    body(size_t(0), n);
+    return;
+  }
+  size_t chunks = (n + chunk - 1) / chunk;
+  std::shared_ptr<ThreadPool> pool = thread_pool();
+  pool->run(chunks, [&body, chunk, n](size_t index) {
+    body(index * chunk, std::min(n, (index + 1) * chunk));
+  });
+}
+
+// Chunked dot product. Chunk partial sums are added by a fixed binary tree (compensated when
+// summation asks for it), so the result is reproducible for any number of threads.
+inline double dot(const std::vector<double> &left, const std::vector<double> &right,
+                  Summation summation = Summation::Fast) {
+  size_t n = right.size();
+  if (n < PARALLEL_MIN_SIZE) {
+    return kernels::dot(left.data(), right.data(), n, summation);
+  }
+  size_t chunks = (n + REDUCTION_CHUNK - 1) / REDUCTION_CHUNK;
+  std::vector<double> partial(chunks);
+  std::vector<double> error(chunks);
+  std::shared_ptr<ThreadPool> pool = thread_pool();
+  pool->run(chunks, [&](size_t index) {
+    size_t begin = index * REDUCTION_CHUNK;
+    size_t length = std::min(n - begin, REDUCTION_CHUNK);
+    partial[index] = kernels::dot(left.data() + begin, right.data() + begin, length, summation);
+  });
+  bool compensated = summation == Summation::Compensated;
+  for (size_t width = 1; width < chunks; width *= 2) {
+    for (size_t i = 0; i + width < chunks; i += 2 * width) {
+      double sum = partial[i] + partial[i + width];
+      if (compensated) {
+        double virtual_right = sum - partial[i];
+        double rounding =
+            (partial[i] - (sum - virtual_right)) + (partial[i + width] - virtual_right);
+        error[i] += error[i + width] + rounding;
+      }
+      partial[i] = sum;
+    }
+  }
+  return partial[0] + error[0];
+}
+
+inline std::vector<double> add(const std::vector<double> &left, const std::vector<double> &right) {
+  std::vector<double> result(left.size());
+  for_chunks(left.size(), detail::map_chunk(3 * sizeof(double)), [&](size_t begin, size_t end) {
+    kernels::add(result.data() + begin, left.data() + begin, right.data() + begin, end - begin);
+  });
+  return result;
+}
+
+inline std::vector<double> sub(const std::vector<double> &left, const std::vector<double> &right) {
+  std::vector<double> result(left.size());
+  for_chunks(left.size(), detail::map_chunk(3 * sizeof(double)), [&](size_t begin, size_t end) {
+    kernels::sub(result.data() + begin, left.data() + begin, right.data() + begin, end - begin);
+  });
+  return result;
+}
+
+inline std::vector<double> negate(const std::vector<double> &source) {
+  std::vector<double> result(source.size());
+  for_chunks(source.size(), detail::map_chunk(2 * sizeof(double)), [&](size_t begin, size_t end) {
+    kernels::negate(result.data() + begin, source.data() + begin, end - begin);
+  });
+  return result;
+}
+
+// Each chunk of the front half swaps with its mirror image in the back half.
+inline void reverse(std::vector<double> &source) {
+  size_t n = source.size();
+  double *values = source.data();
+  for_chunks(n / 2, detail::map_chunk(2 * sizeof(double)), [values, n](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::swap(*(values + i), *(values + n - 1 - i));
+    }
+  });
+}
+
+inline std::vector<int> bitwise_or(const std::vector<int> &left, const std::vector<int> &right) {
+  std::vector<int> result(left.size());
+  for_chunks(left.size(), detail::map_chunk(3 * sizeof(int)), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      result[i] = left[i] | right[i];
+    }
+  });
+  return result;
+}
+
+inline std::vector<int> bitwise_and(const std::vector<int> &left, const std::vector<int> &right) {
+  std::vector<int> result(left.size());
+  for_chunks(left.size(), detail::map_chunk(3 * sizeof(int)), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      result[i] = left[i] & right[i];
+    }
+  });
+  return result;
+}
+
+}  // namespace parallel
+}  // namespace task
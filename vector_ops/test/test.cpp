@@ -6,6 +6,11 @@
 #include <valarray>
 #include <sstream>
 #include <cmath>
+#include <limits>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
 #include "src/vector_ops.h"
 
 
@@ -235,4 +240,436 @@ int main() {
         ASSERT_EQUAL_MSG(vec, vec2, "reverse")
     }
 
+
+    {
+        // Every kernel set the CPU supports, on lengths that leave every possible tail.
+        std::vector<kernels::detail::KernelTable> tables = {
+            {kernels::detail::dot_sse2, kernels::detail::dot_compensated_scalar,
+             kernels::detail::add_sse2, kernels::detail::sub_sse2, kernels::detail::negate_sse2,
+             kernels::detail::axpy_sse2}};
+        if (simd_level() != SimdLevel::SSE2) {
+            tables.push_back({kernels::detail::dot_avx2, kernels::detail::dot_compensated_avx2,
+                              kernels::detail::add_avx2, kernels::detail::sub_avx2,
+                              kernels::detail::negate_avx2, kernels::detail::axpy_avx2});
+        }
+        if (simd_level() == SimdLevel::AVX512) {
+            tables.push_back({kernels::detail::dot_avx512, kernels::detail::dot_compensated_avx512,
+                              kernels::detail::add_avx512, kernels::detail::sub_avx512,
+                              kernels::detail::negate_avx512, kernels::detail::axpy_avx512});
+        }
+        for (const auto &table : tables) {
+            for (size_t n = 0; n < 100; ++n) {
+                std::vector<double> a, b;
+                RandomFillDouble(a, n);
+                RandomFillDouble(b, n);
+                long double expected = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    expected += static_cast<long double>(a[i]) * b[i];
+                }
+                ASSERT_TRUE_MSG(fabs(table.dot(a.data(), b.data(), n) - expected) < EPS,
+                                "Dot kernel")
+                ASSERT_TRUE_MSG(fabs(table.dot_compensated(a.data(), b.data(), n) - expected) < EPS,
+                                "Compensated dot kernel")
+
+                std::vector<double> sum(n), difference(n), negated(n), axpy = a;
+                table.add(sum.data(), a.data(), b.data(), n);
+                table.sub(difference.data(), a.data(), b.data(), n);
+                table.negate(negated.data(), a.data(), n);
+                table.axpy(axpy.data(), 0.5, b.data(), n);
+                bool ok = true;
+                for (size_t i = 0; i < n; ++i) {
+                    ok = ok && sum[i] == a[i] + b[i] && difference[i] == a[i] - b[i] &&
+                         negated[i] == -a[i] && fabs(axpy[i] - (a[i] + 0.5 * b[i])) < EPS;
+                }
+                ASSERT_TRUE_MSG(ok, "Element-wise kernels")
+
+                std::vector<double> negated_b = b;
+                for (auto &item : negated_b) {
+                    item = -item;
+                }
+                table.add(a.data(), a.data(), b.data(), n);
+                table.negate(b.data(), b.data(), n);
+                ASSERT_EQUAL_MSG(a, sum, "Kernel writing into its operand")
+                ASSERT_EQUAL_MSG(b, negated_b, "Kernel writing into its operand")
+            }
+        }
+
+        // 1e16 + 1 - 1e16 loses the 1 to rounding unless the sum is compensated.
+        std::vector<double> a = {1e16, 1., -1e16}, b(3, 1.);
+        ASSERT_TRUE_MSG(dot(a, b, Summation::Compensated) == 1., "Compensated dot")
+        std::vector<double> vec, vec2;
+        RandomFillDouble(vec, RandomUInt(10000, 20000));
+        RandomFillDouble(vec2, vec.size());
+        double reference = dot(vec, vec2, Summation::Compensated);
+        ASSERT_TRUE_MSG(fabs(dot(vec, vec2, Summation::Pairwise) - reference) < EPS &&
+                        fabs(vec * vec2 - reference) < EPS, "Dot summation modes")
+    }
+
+
+    {
+        auto close = [](const std::vector<double> &left, const std::vector<double> &right) {
+            if (left.size() != right.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < left.size(); ++i) {
+                if (fabs(left[i] - right[i]) > EPS) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        for (size_t n = 0; n < 100; n += TossCoin() ? 1 : 7) {
+            std::vector<double> a, b, c;
+            RandomFillDouble(a, n);
+            RandomFillDouble(b, n);
+            RandomFillDouble(c, n);
+            double factor = RandomDouble();
+
+            std::vector<double> eager = a + b - c;
+            std::vector<double> result = lazy(a) + b - c;
+            ASSERT_TRUE_MSG(close(result, eager), "Lazy sum")
+
+            std::vector<double> scaled(n);
+            for (size_t i = 0; i < n; ++i) {
+                scaled[i] = factor * a[i] - b[i] * 2. + -c[i];
+            }
+            result.clear();
+            assign(result, factor * lazy(a) - lazy(b) * 2. + -lazy(c));
+            ASSERT_TRUE_MSG(close(result, scaled), "Lazy scaled and negated expression")
+
+            // The destination may take part in its own expression.
+            std::vector<double> in_place = a;
+            assign(in_place, lazy(in_place) * factor - b);
+            for (size_t i = 0; i < n; ++i) {
+                scaled[i] = a[i] * factor - b[i];
+            }
+            ASSERT_TRUE_MSG(close(in_place, scaled), "Lazy expression reading its destination")
+
+            in_place = a;
+            in_place += lazy(b) - c;
+            ASSERT_TRUE_MSG(close(in_place, eager), "Lazy +=")
+            in_place -= lazy(b) + b;
+            ASSERT_TRUE_MSG(close(in_place, a - b - c), "Lazy -=")
+        }
+    }
+
+
+    {
+        // Expected groups from the group id of every vector, ordered by first member.
+        auto expected_groups = [](const std::vector<size_t> &ids) {
+            std::vector<std::vector<size_t>> groups;
+            std::vector<size_t> position(ids.size(), ids.size());
+            for (size_t i = 0; i < ids.size(); ++i) {
+                if (position[ids[i]] == ids.size()) {
+                    position[ids[i]] = groups.size();
+                    groups.emplace_back();
+                }
+                groups[position[ids[i]]].push_back(i);
+            }
+            return groups;
+        };
+
+        REPEAT(10)
+        {
+            // In one dimension any two random bases would be collinear.
+            size_t dimension = RandomUInt(2, 50), directions = RandomUInt(1, 30);
+            std::vector<std::vector<double>> bases(directions), vectors;
+            for (auto &base : bases) {
+                RandomFillDouble(base, dimension);
+            }
+            std::vector<size_t> collinear_ids, codirectional_ids;
+            for (size_t i = 0; i < 200; ++i) {
+                size_t base = RandomUInt(directions - 1);
+                double scale = std::ldexp(1. + RandomUInt(100), static_cast<int>(RandomUInt(80)) - 40);
+                bool negative = TossCoin();
+                vectors.push_back(lazy(bases[base]) * (negative ? -scale : scale));
+                collinear_ids.push_back(base);
+                codirectional_ids.push_back(2 * base + negative);
+            }
+            ASSERT_TRUE_MSG(collinear_groups(vectors) == expected_groups(collinear_ids),
+                            "collinear_groups")
+            ASSERT_TRUE_MSG(codirectional_groups(vectors) == expected_groups(codirectional_ids),
+                            "codirectional_groups")
+        }
+
+        // High-dimensional one-hot vectors differ only past any fixed prefix of coordinates.
+        size_t dimension = 3000;
+        std::vector<std::vector<double>> vectors;
+        std::vector<size_t> collinear_ids, codirectional_ids;
+        for (size_t i = 0; i < 2 * dimension; ++i) {
+            size_t k = RandomUInt(dimension - 1);
+            bool negative = TossCoin();
+            vectors.emplace_back(dimension, 0.);
+            vectors.back()[k] = (negative ? -1. : 1.) * (1. + RandomUInt(9));
+            collinear_ids.push_back(k);
+            codirectional_ids.push_back(2 * k + negative);
+        }
+        ASSERT_TRUE_MSG(collinear_groups(vectors) == expected_groups(collinear_ids),
+                        "collinear_groups of one-hot vectors")
+        ASSERT_TRUE_MSG(codirectional_groups(vectors) == expected_groups(codirectional_ids),
+                        "codirectional_groups of one-hot vectors")
+
+        // Zero vectors are collinear with each other only; extreme magnitudes are normalized.
+        vectors = {{0., 0.}, {1e-300, 2e-300}, {0., 0.}, {-1e300, -2e300}, {1., 2.}, {1., 2., 0.}};
+        ASSERT_TRUE_MSG(collinear_groups(vectors) ==
+                        std::vector<std::vector<size_t>>({{0, 2}, {1, 3, 4}, {5}}),
+                        "collinear_groups of zero and extreme vectors")
+        ASSERT_TRUE_MSG(codirectional_groups(vectors) ==
+                        std::vector<std::vector<size_t>>({{0}, {1, 4}, {2}, {3}, {5}}),
+                        "codirectional_groups of zero and extreme vectors")
+
+        // A NaN or infinite component is never collinear with anything, zero vectors included.
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        double inf = std::numeric_limits<double>::infinity();
+        vectors = {{0., 0.}, {nan, 0.}, {0., 0.}, {nan, 0.}, {inf, 1.}, {inf, 1.}, {1., 0.}};
+        ASSERT_TRUE_MSG(collinear_groups(vectors) ==
+                        std::vector<std::vector<size_t>>({{0, 2}, {1}, {3}, {4}, {5}, {6}}),
+                        "collinear_groups of non-finite vectors")
+        ASSERT_TRUE_MSG(codirectional_groups(vectors) ==
+                        std::vector<std::vector<size_t>>({{0}, {1}, {2}, {3}, {4}, {5}, {6}}),
+                        "codirectional_groups of non-finite vectors")
+        ASSERT_TRUE_MSG(!(vectors[0] || vectors[1]), "operator|| of zero and NaN vectors")
+        ASSERT_TRUE_MSG(collinear_groups({{1., 0.}, {1., 1e-3}}, 1e-2).size() == 1,
+                        "collinear_groups tolerance")
+    }
+
+
+    {
+        size_t n = parallel::PARALLEL_MIN_SIZE + RandomUInt(3 * parallel::REDUCTION_CHUNK);
+        std::vector<double> a, b;
+        RandomFillDouble(a, n);
+        RandomFillDouble(b, n);
+
+        double expected = 0.;
+        for (size_t i = 0; i < n; ++i) {
+            expected += a[i] * b[i];
+        }
+        const Summation summations[] = {Summation::Fast, Summation::Compensated, Summation::Pairwise};
+        for (Summation summation : summations) {
+            // The reduction tree depends only on the length, so the sum is bitwise reproducible.
+            parallel::set_num_threads(1);
+            ASSERT_TRUE_MSG(parallel::num_threads() == 1, "parallel::set_num_threads")
+            double serial = parallel::dot(a, b, summation);
+            parallel::set_num_threads(3);
+            ASSERT_TRUE_MSG(parallel::num_threads() == 3, "parallel::set_num_threads")
+            double threaded = parallel::dot(a, b, summation);
+            ASSERT_TRUE_MSG(serial == threaded, "parallel::dot reproducibility")
+            ASSERT_TRUE_MSG(std::fabs(threaded - expected) < EPS * std::max(1., std::fabs(expected)),
+                            "parallel::dot")
+        }
+
+        // Cancelling terms: the compensated sum keeps the small remainder exactly. Pairs never
+        // straddle a chunk, so every chunk's partial sum is exact as well.
+        std::vector<double> cancelling = {1e16, 1., -1e16, 0.}, ones(n, 1.);
+        while (cancelling.size() + 2 <= n) {
+            cancelling.push_back(-1e16 * (1. + RandomUInt(9)));
+            cancelling.push_back(-cancelling.back());
+        }
+        cancelling.resize(n, 0.);
+        ASSERT_TRUE_MSG(parallel::dot(cancelling, ones, Summation::Compensated) == 1.,
+                        "parallel::dot compensated")
+
+        // Below PARALLEL_MIN_SIZE the kernel runs on the calling thread.
+        std::vector<double> small(a.begin(), a.begin() + 100), small2(b.begin(), b.begin() + 100);
+        ASSERT_TRUE_MSG(parallel::dot(small, small2) == kernels::dot(small.data(), small2.data(), 100),
+                        "parallel::dot of a short vector")
+    }
+
+    {
+        parallel::set_num_threads(3);
+        for (size_t n : {size_t(0), size_t(1), size_t(1001), parallel::PARALLEL_MIN_SIZE,
+                         3 * parallel::PARALLEL_MIN_SIZE + RandomUInt(1000)}) {
+            std::vector<double> a, b;
+            RandomFillDouble(a, n);
+            RandomFillDouble(b, n);
+            std::vector<double> expected = a + b, result = parallel::add(a, b);
+            ASSERT_EQUAL_MSG(result, expected, "parallel::add")
+            expected = a - b;
+            result = parallel::sub(a, b);
+            ASSERT_EQUAL_MSG(result, expected, "parallel::sub")
+            expected = -a;
+            result = parallel::negate(a);
+            ASSERT_EQUAL_MSG(result, expected, "parallel::negate")
+            expected = a;
+            reverse(expected);
+            parallel::reverse(a);
+            ASSERT_EQUAL_MSG(a, expected, "parallel::reverse")
+
+            std::vector<int> c, d;
+            RandomFill(c, n);
+            RandomFill(d, n);
+            std::vector<int> expected_bits = c | d, bits = parallel::bitwise_or(c, d);
+            ASSERT_EQUAL_MSG(bits, expected_bits, "parallel::bitwise_or")
+            expected_bits = c & d;
+            bits = parallel::bitwise_and(c, d);
+            ASSERT_EQUAL_MSG(bits, expected_bits, "parallel::bitwise_and")
+        }
+    }
+
+    {
+        // Resizing the pool while another thread runs on it must not free the pool in use.
+        size_t n = 2 * parallel::PARALLEL_MIN_SIZE;
+        std::vector<double> a, b;
+        RandomFillDouble(a, n);
+        RandomFillDouble(b, n);
+        parallel::set_num_threads(1);
+        double expected = parallel::dot(a, b);
+        std::atomic<bool> stop{false}, mismatch{false};
+        std::thread runner([&]() {
+            while (!stop.load()) {
+                if (parallel::dot(a, b) != expected) {
+                    mismatch = true;
+                }
+                std::vector<double> sum = parallel::add(a, b);
+                if (sum[n - 1] != a[n - 1] + b[n - 1]) {
+                    mismatch = true;
+                }
+            }
+        });
+        for (size_t i = 0; i < 50; ++i) {
+            parallel::set_num_threads(1 + i % 4);
+            std::this_thread::yield();
+        }
+        stop = true;
+        runner.join();
+        ASSERT_TRUE_MSG(!mismatch, "parallel ops during set_num_threads")
+    }
+
+    {
+        // A chunk's exception reaches the caller after the other chunks finish.
+        size_t n = 2 * parallel::PARALLEL_MIN_SIZE;
+        parallel::set_num_threads(3);
+        std::atomic<size_t> visited{0};
+        bool thrown = false;
+        try {
+            parallel::for_chunks(n, 1000, [&visited](size_t begin, size_t) {
+                ++visited;
+                if (begin == 5000) {
+                    throw std::runtime_error("chunk");
+                }
+            });
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        ASSERT_TRUE_MSG(thrown && visited == (n + 999) / 1000, "parallel::for_chunks exception")
+    }
+
+    {
+        for (size_t n : {size_t(0), size_t(1), size_t(31), size_t(32), size_t(33), size_t(64),
+                         size_t(65), RandomUInt(1, 1000), RandomUInt(1, 1000)}) {
+            // Any non-zero int marks a set bit.
+            std::vector<int> mask_a(n), mask_b(n), ints_a(n), ints_b(n);
+            size_t count_a = 0;
+            for (size_t i = 0; i < n; ++i) {
+                mask_a[i] = TossCoin() ? static_cast<int>(RandomUInt(1, 1000)) * (TossCoin() ? 1 : -1) : 0;
+                mask_b[i] = TossCoin() ? -1 : 0;
+                ints_a[i] = mask_a[i] != 0;
+                ints_b[i] = mask_b[i] != 0;
+                count_a += ints_a[i];
+            }
+
+            std::vector<int> moved = mask_b;
+            Bitset a(mask_a), b(std::move(moved));
+            ASSERT_TRUE_MSG(a.size() == n && a.word_size() == (n + 31) / 32, "Bitset size")
+            ASSERT_TRUE_MSG(a.count() == count_a, "Bitset::count")
+            std::vector<int> unpacked = a.to_ints();
+            ASSERT_EQUAL_MSG(unpacked, ints_a, "Bitset from a const mask")
+            unpacked = b.to_ints();
+            ASSERT_EQUAL_MSG(unpacked, ints_b, "Bitset from a moved mask")
+            unpacked = Bitset(b).to_ints();
+            ASSERT_EQUAL_MSG(unpacked, ints_b, "Bitset::to_ints of an rvalue")
+
+            ASSERT_TRUE_MSG(Bitset(n).count() == 0 && Bitset(n, true).count() == n,
+                            "Bitset filled constructor")
+            unpacked = Bitset(n, true).to_ints();
+            ASSERT_TRUE_MSG(unpacked == std::vector<int>(n, 1), "Bitset filled constructor")
+            ASSERT_TRUE_MSG(Bitset(n, true) == Bitset(std::vector<int>(n, 7)), "Bitset ==")
+            ASSERT_TRUE_MSG(Bitset(n) != Bitset(n + 1) && !(a != a), "Bitset !=")
+
+            std::vector<int> expected(n);
+            for (size_t i = 0; i < n; ++i) {
+                expected[i] = ints_a[i] | ints_b[i];
+            }
+            unpacked = (a | b).to_ints();
+            ASSERT_EQUAL_MSG(unpacked, expected, "Bitset operator|")
+            Bitset c = a;
+            c |= b;
+            ASSERT_TRUE_MSG(c == Bitset(expected), "Bitset operator|=")
+
+            for (size_t i = 0; i < n; ++i) {
+                expected[i] = ints_a[i] & ints_b[i];
+            }
+            unpacked = (a & b).to_ints();
+            ASSERT_EQUAL_MSG(unpacked, expected, "Bitset operator&")
+            c = a;
+            c &= b;
+            ASSERT_TRUE_MSG(c == Bitset(expected), "Bitset operator&=")
+
+            for (size_t i = 0; i < n; ++i) {
+                expected[i] = ints_a[i] ^ ints_b[i];
+            }
+            unpacked = (a ^ b).to_ints();
+            ASSERT_EQUAL_MSG(unpacked, expected, "Bitset operator^")
+            c = a;
+            c ^= b;
+            ASSERT_TRUE_MSG(c == Bitset(expected), "Bitset operator^=")
+
+            for (size_t i = 0; i < n; ++i) {
+                expected[i] = ints_a[i] & !ints_b[i];
+            }
+            unpacked = and_not(a, b).to_ints();
+            ASSERT_EQUAL_MSG(unpacked, expected, "and_not")
+            c = a;
+            c.and_not(b);
+            ASSERT_TRUE_MSG(c == Bitset(expected), "Bitset::and_not")
+
+            // Agrees with operator| and operator& on the unpacked masks.
+            expected = ints_a | ints_b;
+            ASSERT_TRUE_MSG((a | b) == Bitset(expected), "Bitset operator| against vector<int>")
+            expected = ints_a & ints_b;
+            ASSERT_TRUE_MSG((a & b) == Bitset(expected), "Bitset operator& against vector<int>")
+
+            // Flipping the tail of the last word through ^ keeps the bits past size() zero.
+            c = a ^ Bitset(n, true);
+            ASSERT_TRUE_MSG(c.count() == n - count_a, "Bitset complement")
+            if (n % 32 != 0) {
+                ASSERT_TRUE_MSG(*(c.words() + c.word_size() - 1) >> (n % 32) == 0, "Bitset tail")
+            }
+
+            if (n > 0) {
+                size_t i = RandomUInt(n - 1);
+                c = a;
+                c.set(i);
+                ASSERT_TRUE_MSG(c.test(i) && c.count() == count_a + !ints_a[i], "Bitset::set")
+                c.reset(i);
+                ASSERT_TRUE_MSG(!c.test(i) && c.count() == count_a - ints_a[i], "Bitset::reset")
+                c.set(i, ints_a[i] != 0);
+                ASSERT_TRUE_MSG(c == a, "Bitset::set of a value")
+            }
+        }
+
+        // Binary operations reject bitsets of different sizes, whichever side is longer.
+        Bitset shorter(40, true), longer(100, true);
+        std::vector<std::function<void(Bitset &, const Bitset &)>> operations = {
+            [](Bitset &x, const Bitset &y) { x |= y; },
+            [](Bitset &x, const Bitset &y) { x &= y; },
+            [](Bitset &x, const Bitset &y) { x ^= y; },
+            [](Bitset &x, const Bitset &y) { x.and_not(y); },
+            [](Bitset &x, const Bitset &y) { x = x | y; },
+            [](Bitset &x, const Bitset &y) { x = x & y; },
+            [](Bitset &x, const Bitset &y) { x = x ^ y; },
+            [](Bitset &x, const Bitset &y) { x = and_not(x, y); }};
+        size_t rejected = 0;
+        for (auto &operation : operations) {
+            for (bool longer_left : {false, true}) {
+                Bitset left = longer_left ? longer : shorter;
+                try {
+                    operation(left, longer_left ? shorter : longer);
+                } catch (const std::invalid_argument &) {
+                    ++rejected;
+                }
+            }
+        }
+        ASSERT_TRUE_MSG(rejected == 2 * operations.size(), "Bitset operations of different sizes")
+    }
 }